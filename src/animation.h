@@ -10,132 +10,374 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
 #include "bone.h"
+#include "animation_clip.h"
+#include "clip_compression.h"
 #include <functional>
 #include "animdata.h"
 #include "model_animation.h"
-
-struct AssimpNodeData
-{
-    glm::mat4 transformation;
-    std::string name;
-    int childrenCount;
-    std::vector<AssimpNodeData> children;
-};
+#include "import_session.h"
+#include "cooked_asset.h"
+#include "skeleton.h"
+#include "skeleton_binding.h"
 
 class Animation
 {
 public:
     Animation() = default;
 
-    Animation(const std::string& animationPath, Model* model)
+    Animation(const std::string& animationPath, Model* model,
+              const AnimationImportSettings& settings = AnimationImportSettings())
     {
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
-        assert(scene && scene->mRootNode);
-        auto animation = scene->mAnimations[0];
-        m_Duration = animation->mDuration;
-        m_TicksPerSecond = animation->mTicksPerSecond;
-        aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
-        globalTransformation = globalTransformation.Inverse();
-        ReadHeirarchyData(m_RootNode, scene->mRootNode);
-        ReadMissingBones(animation, *model);
+        ImportSession session(animationPath, ImportProfile::AnimationOnly());
+        Load(session, model, settings);
     }
 
-    ~Animation()
+    /* the first clip of a scene that was already parsed, e.g. by the session model was built from */
+    Animation(const ImportSession& session, Model* model,
+              const AnimationImportSettings& settings = AnimationImportSettings())
+    {
+        Load(session, model, settings);
+    }
+
+    /* one clip of a scene whose skeleton binding is shared with its other clips. the model the
+       binding was made from has to know every bone of the clip already, see ReadMissingBones. */
+    Animation(const aiAnimation* animation, std::shared_ptr<const SkeletonBinding> binding,
+              const AnimationImportSettings& settings = AnimationImportSettings())
+        : m_Binding(binding)
     {
+        ReadClip(animation, settings);
     }
 
-    Bone* FindBone(const std::string& name)
+    /* the first clip of a cooked asset, with a binding of its own like the path constructor */
+    Animation(const CookedAsset& asset, Model* model)
+        : Animation(asset, 0, std::make_shared<const SkeletonBinding>(asset.GetSkeleton(), model->GetBoneInfoMap()))
     {
-        auto iter = std::find_if(m_Bones.begin(), m_Bones.end(),
-            [&](const Bone& bone)
+    }
+
+    /* clip of a cooked asset whose binding is shared with its other clips. the keys are not
+       copied, the clip samples them from the asset's mapping, so the asset has to outlive it.
+       when the asset is invalid or has no such clip the animation is invalid, see IsValid() */
+    Animation(const CookedAsset& asset, int clip, std::shared_ptr<const SkeletonBinding> binding)
+        : m_Binding(binding)
+    {
+        if (clip < 0 || clip >= asset.GetNumClips())
+        {
+            std::cout << "ERROR::COOKED:: no clip " << clip << " in " << asset.GetPath() << std::endl;
+            // no tracks and no length, every node stays in its bind pose
+            m_Valid = false;
+            m_Duration = 0.0f;
+            m_TicksPerSecond = 0;
+            m_NodeTracks.assign(GetSkeleton().GetNumNodes(), -1);
+            return;
+        }
+        const CookedClip& cooked = asset.GetClip(clip);
+        m_Name = asset.GetString(cooked.name);
+        m_Duration = cooked.duration;
+        m_TicksPerSecond = static_cast<int>(cooked.ticksPerSecond);
+        m_Clip = AnimationClip(cooked.layout, asset.GetClipData(clip));
+
+        const CookedTrack* tracks = asset.GetTracks(clip);
+        for (int i = 0; i < m_Clip.GetNumTracks(); i++)
+        {
+            m_Bones.push_back(Bone(&m_Clip, i, tracks[i].boneID));
+            m_BoneNames.push_back(asset.GetString(tracks[i].name));
+            m_RestPose.push_back(m_Bones.back().GetRestPose());
+        }
+        const int32_t* nodeTracks = asset.GetNodeTracks(clip);
+        m_NodeTracks.assign(nodeTracks, nodeTracks + GetSkeleton().GetNumNodes());
+    }
+
+    /* gives every bone animation animates but the model's meshes do not use a slot of the
+       final bone matrices */
+    static void ReadMissingBones(const aiAnimation* animation, Model& model)
+    {
+        auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
+        int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
+        for (unsigned int i = 0; i < animation->mNumChannels; i++)
+        {
+            std::string boneName = animation->mChannels[i]->mNodeName.data;
+            if (boneInfoMap.find(boneName) == boneInfoMap.end())
             {
-                return bone.GetBoneName() == name;
+                boneInfoMap[boneName].id = boneCount;
+                boneCount++;
             }
-        );
-        if (iter == m_Bones.end()) return nullptr;
-        else return &(*iter);
+        }
     }
 
+    // bones point into m_Clip or m_CompressedClip
+    Animation(const Animation&) = delete;
+    Animation& operator=(const Animation&) = delete;
+
+    ~Animation()
+    {
+    }
+
+    const Bone* FindBone(const std::string& name) const
+    {
+        int track = FindTrack(name);
+        if (track < 0) return nullptr;
+        else return &m_Bones[track];
+    }
+
+    /* track of the bone called name, -1 if the clip does not animate it. linear search, not meant per frame */
+    int FindTrack(const std::string& name) const
+    {
+        auto iter = std::find(m_BoneNames.begin(), m_BoneNames.end(), name);
+        if (iter == m_BoneNames.end()) return -1;
+        else return static_cast<int>(iter - m_BoneNames.begin());
+    }
+
+    inline const Bone& GetBone(int track) const { return m_Bones[track]; }
+    inline const std::string& GetTrackName(int track) const { return m_BoneNames[track]; }
+    inline int GetNumTracks() const { return static_cast<int>(m_Bones.size()); }
+
+    /* prepares the playback state of one instance. the animation itself is never written
+       after loading, so instances on different threads can share it. */
+    void BindPlayback(PlaybackState& state) const
+    {
+        state.Bind(this, m_RestPose.data(), GetNumTracks());
+    }
+
+    /* binding tables indexed by skeleton node, resolved once at load so playback needs no names:
+       the track animating the node, the slot of the final bone matrices it writes and the
+       offset matrix that goes with that slot. -1 marks nodes without a track or slot. only the
+       tracks belong to the clip, the rest is shared with every clip of the same scene. */
+    inline const int* GetNodeTracks() const { return m_NodeTracks.data(); }
+    inline const int* GetNodeSlots() const { return m_Binding->GetNodeSlots(); }
+    inline const glm::mat4* GetNodeOffsets() const { return m_Binding->GetNodeOffsets(); }
+    /* non-zero for detail nodes: small extremities such as fingers or helper bones, whose bind
+       pose subtree spans less than SkeletonBinding::DetailBoneFraction of the whole skeleton */
+    inline const unsigned char* GetDetailNodes() const { return m_Binding->GetDetailNodes(); }
+
     
-    inline float GetTicksPerSecond() { return m_TicksPerSecond; }
-    inline float GetDuration() { return m_Duration;}
-    inline const AssimpNodeData& GetRootNode() { return m_RootNode; }
-    inline const std::map<std::string,BoneInfo>& GetBoneIDMap()
+    /* false when there was no clip to load, e.g. from an invalid cooked asset */
+    inline bool IsValid() const { return m_Valid; }
+    inline const std::string& GetName() const { return m_Name; }
+    inline float GetTicksPerSecond() const { return m_TicksPerSecond; }
+    inline float GetDuration() const { return m_Duration;}
+    inline const Skeleton& GetSkeleton() const { return m_Binding->GetSkeleton(); }
+    inline const std::shared_ptr<const SkeletonBinding>& GetBinding() const { return m_Binding; }
+    /* the float keys, empty when the clip was imported compressed */
+    inline const AnimationClip& GetClip() const { return m_Clip; }
+    inline bool IsCompressed() const { return m_CompressedClip.GetNumTracks() > 0; }
+    inline const std::map<std::string,BoneInfo>& GetBoneIDMap() const
     {
-        return m_BoneInfoMap;
+        return m_Binding->GetBoneInfoMap();
     }
 
-    std::vector<std::string> GetKeyframeBones()
+    std::vector<std::string> GetKeyframeBones() const
 //    void GetKeyframeBones()
     {
         std::vector<std::string> keyframe_bones;
         keyframe_bones.push_back("None");
 
-        for (int i = 0; i < m_Bones.size(); i++)
-        {
-            std::string s = m_Bones[i].GetBoneName();
-            keyframe_bones.push_back(s.c_str());
-        }
+        for (const std::string& name : m_BoneNames)
+            keyframe_bones.push_back(name);
         return keyframe_bones;
     }
 //    
 private:
-    void ReadMissingBones(const aiAnimation* animation, Model& model)
+    void Load(const ImportSession& session, Model* model, const AnimationImportSettings& settings)
     {
-        int size = animation->mNumChannels;
+        assert(session.HasHierarchy());
+        const aiScene* scene = session.GetScene();
+        auto animation = scene->mAnimations[0];
+        ReadMissingBones(animation, *model);
+        m_Binding = std::make_shared<const SkeletonBinding>(scene->mRootNode, model->GetBoneInfoMap());
+        ReadClip(animation, settings);
+    }
 
-        auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
-        int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
+    void ReadClip(const aiAnimation* animation, const AnimationImportSettings& settings)
+    {
+        m_Name = animation->mName.data;
+        m_Duration = animation->mDuration;
+        m_TicksPerSecond = animation->mTicksPerSecond;
+        int size = animation->mNumChannels;
+        const std::map<std::string, BoneInfo>& boneInfoMap = m_Binding->GetBoneInfoMap();
 
         //reading channels(bones engaged in an animation and their keyframes)
+        std::vector<BoneKeys> tracks;
+        tracks.reserve(size);
         for (int i = 0; i < size; i++)
+            tracks.push_back(BoneKeys(animation->mChannels[i]));
+
+        std::ostream& log = settings.log ? *settings.log : std::cout;
+        int numFoldedKeys = 0;
+        for (BoneKeys& track : tracks)
+            numFoldedKeys += track.FoldConstantChannels();
+
+        float invSampleInterval = 0.0f;
+        if (settings.resampleRate > 0.0f && m_TicksPerSecond > 0)
         {
-            auto channel = animation->mChannels[i];
-            std::string boneName = channel->mNodeName.data;
-//             std::cout << "m_bones\n" << boneName << std::endl;
-            
-            if (boneInfoMap.find(boneName) == boneInfoMap.end())
-            {
-                boneInfoMap[boneName].id = boneCount;
-                boneCount++;
-                
-                
-            }
-            
-            auto newBone = Bone(channel->mNodeName.data,
-                                boneInfoMap[channel->mNodeName.data].id,
-                                channel);
-            m_Bones.push_back(newBone);
-            // std::cout << newBone.GetBoneName() << std::endl;
+            float sampleInterval = m_TicksPerSecond / settings.resampleRate;
+            ResampleTracks(tracks, sampleInterval, log);
+            invSampleInterval = 1.0f / sampleInterval;
+        }
+
+        if (settings.reducePositionTolerance > 0.0f)
+        {
+            ReduceTracks(tracks, settings, log);
+            // reduced tracks are no longer on the uniform grid
+            invSampleInterval = 0.0f;
+        }
+
+        // pack every track into one blob, bones only keep their track index
+        m_Clip = AnimationClip(tracks, invSampleInterval);
+        PrintStaticPoseStats(numFoldedKeys, log);
+        if (settings.compress)
+            CompressClip(tracks, log);
+
+        for (int i = 0; i < size; i++)
+        {
+            auto boneInfo = boneInfoMap.find(tracks[i].name);
+            int id = boneInfo != boneInfoMap.end() ? boneInfo->second.id : -1;
+            if (IsCompressed())
+                m_Bones.push_back(Bone(&m_CompressedClip, i, id));
+            else
+                m_Bones.push_back(Bone(&m_Clip, i, id));
+            m_BoneNames.push_back(tracks[i].name);
+            m_RestPose.push_back(m_Bones.back().GetRestPose());
         }
 
-        m_BoneInfoMap = boneInfoMap;
+        BindTracks();
     }
 
-    void ReadHeirarchyData(AssimpNodeData& dest, const aiNode* src)
+    void BindTracks()
     {
-        assert(src);
+        const Skeleton& skeleton = GetSkeleton();
+        m_NodeTracks.assign(skeleton.GetNumNodes(), -1);
+        for (int node = 0; node < skeleton.GetNumNodes(); node++)
+            m_NodeTracks[node] = FindTrack(skeleton.GetName(node));
+    }
 
-        dest.name = src->mName.data;
-        dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
-        dest.childrenCount = src->mNumChildren;
+    void PrintStaticPoseStats(int numFoldedKeys, std::ostream& log)
+    {
+        int numTracks = m_Clip.GetNumTracks();
+        int numAnimated = m_Clip.GetNumAnimatedTracks(PositionChannel) + m_Clip.GetNumAnimatedTracks(RotationChannel)
+                        + m_Clip.GetNumAnimatedTracks(ScaleChannel);
+        int numStatic = 0;
+        for (int i = 0; i < numTracks; i++)
+            numStatic += m_Clip.IsStaticTrack(i);
+        log << "static pose: folded " << NumChannelTypes * numTracks - numAnimated << " of " << NumChannelTypes * numTracks
+                  << " channels (" << numFoldedKeys << " duplicate keys), " << numStatic << " of " << numTracks
+                  << " bones fully static" << std::endl;
+    }
 
-        for (int i = 0; i < src->mNumChildren; i++)
+    void ResampleTracks(std::vector<BoneKeys>& tracks, float sampleInterval, std::ostream& log)
+    {
+        log << "resampled every " << sampleInterval << " ticks, max error per track (position / rotation rad / scale):" << std::endl;
+        for (BoneKeys& track : tracks)
+        {
+            track.Resample(m_Duration, sampleInterval);
+            const TrackError& error = track.resampleError;
+            log << "  " << track.name << ": " << error.position << " / "
+                      << error.rotation << " / " << error.scale << std::endl;
+        }
+    }
+
+    /* every joint stays within reducePositionTolerance of where the source keys put it in model
+       space. the errors of the animated channels down a chain add up at its end, so every channel
+       gets an equal share of the tolerance of the longest chain running through its node. keys may
+       stretch bones past their bind length, so the lever of a node is the longest chain of bones
+       below it, each at the longest translation any of its keys gives it. the bound is first order:
+       ancestor scales are taken from the bind pose and scale errors scale the errors below them. */
+    void ReduceTracks(std::vector<BoneKeys>& tracks, const AnimationImportSettings& settings, std::ostream& log)
+    {
+        const Skeleton& skeleton = GetSkeleton();
+        std::vector<SkeletonBinding::BindReach> reaches;
+        m_Binding->MeasureBindReach(reaches);
+
+        int numNodes = skeleton.GetNumNodes();
+        std::vector<int> nodeTracks(numNodes, -1);
+        std::vector<int> channels(numNodes, 0);
+        for (int i = 0; i < static_cast<int>(tracks.size()); i++)
+        {
+            int node = skeleton.FindNode(tracks[i].name);
+            if (node < 0)
+                continue;
+            nodeTracks[node] = i;
+            channels[node] = tracks[i].GetNumAnimatedChannels();
+        }
+
+        // the longest translation of every bone and the longest chain of those below every node
+        const int* parents = skeleton.GetParents();
+        const glm::mat4* bindTransforms = skeleton.GetBindTransforms();
+        std::vector<float> lengths(numNodes), levers(numNodes, 0.0f);
+        for (int node = 0; node < numNodes; node++)
+        {
+            float length = glm::length(glm::vec3(bindTransforms[node][3]));
+            if (nodeTracks[node] >= 0)
+            {
+                for (const glm::vec3& position : tracks[nodeTracks[node]].positions.values)
+                    length = std::max(length, glm::length(position));
+            }
+            lengths[node] = length * reaches[node].parentScale;
+        }
+        for (int node = numNodes - 1; node > 0; node--)
+            levers[parents[node]] = std::max(levers[parents[node]], lengths[node] + levers[node]);
+
+        // animated channels from the root down to every node, and from every node down to its deepest leaf
+        std::vector<int> above(numNodes), below(channels);
+        for (int node = 0; node < numNodes; node++)
+            above[node] = channels[node] + (parents[node] < 0 ? 0 : above[parents[node]]);
+        for (int node = numNodes - 1; node > 0; node--)
+            below[parents[node]] = std::max(below[parents[node]], channels[parents[node]] + below[node]);
+
+        int numKeys = 0, numRemoved = 0;
+        for (const BoneKeys& track : tracks)
+            numKeys += track.GetNumKeys();
+        for (int node = 0; node < numNodes; node++)
+        {
+            if (nodeTracks[node] < 0)
+                continue;
+            int chainChannels = std::max(above[node] + below[node] - channels[node], 1);
+            // leaves only move their own skin, the bone length stands in for its extent
+            float lever = levers[node] > 0.0f ? levers[node] : lengths[node];
+            numRemoved += tracks[nodeTracks[node]].Reduce(settings.reducePositionTolerance / chainChannels, settings.reduceAngleTolerance,
+                                                          lever, reaches[node].parentScale);
+        }
+        log << "reduced keys " << numKeys << " -> " << numKeys - numRemoved << std::endl;
+    }
+
+    void CompressClip(const std::vector<BoneKeys>& tracks, std::ostream& log)
+    {
+        m_CompressedClip = CompressedAnimationClip(m_Clip);
+        if (m_Clip.GetNumTracks() > 0 && !IsCompressed())
         {
-            AssimpNodeData newData;
-            ReadHeirarchyData(newData, src->mChildren[i]);
-            dest.children.push_back(newData);
+            log << "clip " << m_Name << " not compressed, its keys are too dense for 16 bit frame indices" << std::endl;
+            return;
         }
+        size_t sourceSize = m_Clip.GetSizeInBytes();
+        size_t compressedSize = m_CompressedClip.GetSizeInBytes();
+        log << "compressed clip " << sourceSize << " -> " << compressedSize << " bytes (saved "
+                  << sourceSize - compressedSize << "), max error per bone (position / rotation rad / scale):" << std::endl;
+        for (int i = 0; i < m_CompressedClip.GetNumTracks(); i++)
+        {
+            const TrackError& error = m_CompressedClip.GetError(i);
+            log << "  " << tracks[i].name << ": " << error.position << " / "
+                      << error.rotation << " / " << error.scale << std::endl;
+        }
+        // the float keys are no longer needed
+        m_Clip = AnimationClip();
     }
+
+    std::string m_Name;
     float m_Duration;
     int m_TicksPerSecond;
+    bool m_Valid = true;
+    AnimationClip m_Clip;
+    CompressedAnimationClip m_CompressedClip;
     std::vector<Bone> m_Bones;
-    AssimpNodeData m_RootNode;
-    std::map<std::string, BoneInfo> m_BoneInfoMap;
+    // names of the bones in m_Bones, kept apart so sampling never touches strings
+    std::vector<std::string> m_BoneNames;
+    // pose every playback starts from, constant channels never change it
+    std::vector<BoneTransform> m_RestPose;
+    std::shared_ptr<const SkeletonBinding> m_Binding;
+    std::vector<int> m_NodeTracks;
 };
 
 #endif /* animation_h */
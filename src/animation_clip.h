@@ -0,0 +1,295 @@
+//
+//  animation_clip.h
+//  skeletal_animation
+//
+
+#ifndef animation_clip_h
+#define animation_clip_h
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "keyframe.h"
+#include "pose.h"
+
+/* byte buffer made of 16 byte aligned sections that are addressed by offset,
+   so it can be copied or relocated as is */
+class SectionBlob
+{
+public:
+    SectionBlob() = default;
+
+    /* read only view of a blob of size bytes written out earlier, data has to stay alive and
+       be 16 byte aligned */
+    SectionBlob(const void* data, size_t size) : m_View(static_cast<const unsigned char*>(data)), m_Size(size)
+    {
+    }
+
+    /* reserves a section of size bytes and returns its offset, call Allocate() once all are added */
+    size_t AddSection(size_t size)
+    {
+        size_t offset = m_Size;
+        m_Size += (size + sizeof(glm::vec4) - 1) / sizeof(glm::vec4) * sizeof(glm::vec4);
+        return offset;
+    }
+
+    void Allocate()
+    {
+        m_Storage.assign(m_Size / sizeof(glm::vec4), glm::vec4(0.0f));
+    }
+
+    template <typename T>
+    const T* Get(size_t offset) const
+    {
+        return reinterpret_cast<const T*>(GetData() + offset);
+    }
+
+    template <typename T>
+    T* Get(size_t offset)
+    {
+        return reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(m_Storage.data()) + offset);
+    }
+
+    inline size_t GetSizeInBytes() const { return m_Size; }
+    inline const unsigned char* GetData() const
+    {
+        return m_View ? m_View : reinterpret_cast<const unsigned char*>(m_Storage.data());
+    }
+
+private:
+    // vec4 elements keep every section 16 byte aligned
+    std::vector<glm::vec4> m_Storage;
+    const unsigned char* m_View = nullptr;
+    size_t m_Size = 0;
+};
+
+/* where the keys of one channel of a track live inside the clip blob */
+struct ChannelRange {
+    int timeOffset;  // into GetTimes()
+    int keyOffset;   // into GetPositions(), GetRotations() or GetScales()
+    int numKeys;
+};
+
+struct TrackRange {
+    ChannelRange position;
+    ChannelRange rotation;
+    ChannelRange scale;
+};
+
+enum ChannelType {
+    PositionChannel,
+    RotationChannel,
+    ScaleChannel,
+    NumChannelTypes
+};
+
+/* where every section of an AnimationClip blob starts and what it holds, all a blob written
+   out by GetData() needs to be used again. fixed size fields, so it can be stored as is. */
+struct AnimationClipLayout {
+    uint64_t size;
+    uint64_t tracksOffset;
+    uint64_t timesOffset;
+    uint64_t positionsOffset;
+    uint64_t rotationsOffset;
+    uint64_t scalesOffset;
+    uint64_t staticPoseOffset;
+    uint64_t animatedTracksOffset;
+    int32_t numTracks;
+    int32_t numAnimatedTracks[NumChannelTypes];
+    float invSampleInterval;
+    int32_t reserved[3];
+};
+
+/* all keyframes of a clip in one contiguous blob laid out as structure-of-arrays:
+     [track table][times][positions][rotations][scales][static pose][animated tracks]
+   tracks are stored one after another inside every array, so sampling all bones walks
+   each array front to back.
+
+   channels with a single key are constant. their value lives in the static pose, which
+   samplers copy once, and only the tracks listed as animated for a channel type are
+   sampled per frame. */
+class AnimationClip
+{
+public:
+    AnimationClip() = default;
+
+    /* invSampleInterval is non-zero when every track was resampled to the same uniform grid */
+    AnimationClip(const std::vector<BoneKeys>& bones, float invSampleInterval = 0.0f)
+        : m_NumTracks(static_cast<int>(bones.size())), m_InvSampleInterval(invSampleInterval)
+    {
+        int numPositions = 0, numRotations = 0, numScales = 0;
+        for (const BoneKeys& bone : bones)
+        {
+            numPositions += bone.positions.Size();
+            numRotations += bone.rotations.Size();
+            numScales += bone.scales.Size();
+        }
+        int numTimes = numPositions + numRotations + numScales;
+
+        for (const BoneKeys& bone : bones)
+        {
+            m_NumAnimatedTracks[PositionChannel] += bone.positions.Size() > 1;
+            m_NumAnimatedTracks[RotationChannel] += bone.rotations.Size() > 1;
+            m_NumAnimatedTracks[ScaleChannel] += bone.scales.Size() > 1;
+        }
+        int numAnimated = m_NumAnimatedTracks[PositionChannel] + m_NumAnimatedTracks[RotationChannel] + m_NumAnimatedTracks[ScaleChannel];
+
+        m_TracksOffset = m_Blob.AddSection(m_NumTracks * sizeof(TrackRange));
+        m_TimesOffset = m_Blob.AddSection(numTimes * sizeof(float));
+        m_PositionsOffset = m_Blob.AddSection(numPositions * sizeof(glm::vec3));
+        m_RotationsOffset = m_Blob.AddSection(numRotations * sizeof(glm::quat));
+        m_ScalesOffset = m_Blob.AddSection(numScales * sizeof(glm::vec3));
+        m_StaticPoseOffset = m_Blob.AddSection(m_NumTracks * sizeof(BoneTransform));
+        m_AnimatedTracksOffset = m_Blob.AddSection(numAnimated * sizeof(int));
+        m_Blob.Allocate();
+
+        TrackRange* tracks = m_Blob.Get<TrackRange>(m_TracksOffset);
+        int timeOffset = 0, positionOffset = 0, rotationOffset = 0, scaleOffset = 0;
+        for (int track = 0; track < m_NumTracks; ++track)
+        {
+            tracks[track].position = PackChannel(bones[track].positions, timeOffset, positionOffset, m_Blob.Get<glm::vec3>(m_PositionsOffset));
+            tracks[track].rotation = PackChannel(bones[track].rotations, timeOffset, rotationOffset, m_Blob.Get<glm::quat>(m_RotationsOffset));
+            tracks[track].scale = PackChannel(bones[track].scales, timeOffset, scaleOffset, m_Blob.Get<glm::vec3>(m_ScalesOffset));
+            AlignHemispheres(tracks[track].rotation);
+        }
+        BuildStaticPose();
+    }
+
+    /* view of a blob written out earlier, layout is the GetLayout() it was written with. the
+       blob has to outlive the clip and every copy of it */
+    AnimationClip(const AnimationClipLayout& layout, const void* blob)
+        : m_Blob(blob, layout.size),
+          m_TracksOffset(layout.tracksOffset), m_TimesOffset(layout.timesOffset),
+          m_PositionsOffset(layout.positionsOffset), m_RotationsOffset(layout.rotationsOffset),
+          m_ScalesOffset(layout.scalesOffset), m_StaticPoseOffset(layout.staticPoseOffset),
+          m_AnimatedTracksOffset(layout.animatedTracksOffset), m_NumTracks(layout.numTracks),
+          m_InvSampleInterval(layout.invSampleInterval)
+    {
+        for (int type = 0; type < NumChannelTypes; type++)
+            m_NumAnimatedTracks[type] = layout.numAnimatedTracks[type];
+    }
+
+    AnimationClipLayout GetLayout() const
+    {
+        AnimationClipLayout layout = {};
+        layout.size = m_Blob.GetSizeInBytes();
+        layout.tracksOffset = m_TracksOffset;
+        layout.timesOffset = m_TimesOffset;
+        layout.positionsOffset = m_PositionsOffset;
+        layout.rotationsOffset = m_RotationsOffset;
+        layout.scalesOffset = m_ScalesOffset;
+        layout.staticPoseOffset = m_StaticPoseOffset;
+        layout.animatedTracksOffset = m_AnimatedTracksOffset;
+        layout.numTracks = m_NumTracks;
+        for (int type = 0; type < NumChannelTypes; type++)
+            layout.numAnimatedTracks[type] = m_NumAnimatedTracks[type];
+        layout.invSampleInterval = m_InvSampleInterval;
+        return layout;
+    }
+
+    /* the whole blob, GetSizeInBytes() bytes */
+    inline const unsigned char* GetData() const { return m_Blob.GetData(); }
+
+    inline int GetNumTracks() const { return m_NumTracks; }
+    inline const TrackRange& GetTrack(int track) const { return m_Blob.Get<TrackRange>(m_TracksOffset)[track]; }
+    inline const float* GetTimes() const { return m_Blob.Get<float>(m_TimesOffset); }
+    inline const glm::vec3* GetPositions() const { return m_Blob.Get<glm::vec3>(m_PositionsOffset); }
+    inline const glm::quat* GetRotations() const { return m_Blob.Get<glm::quat>(m_RotationsOffset); }
+    inline const glm::vec3* GetScales() const { return m_Blob.Get<glm::vec3>(m_ScalesOffset); }
+    inline float GetInvSampleInterval() const { return m_InvSampleInterval; }
+
+    /* values of the constant channels, indexed by track. entries of animated channels hold the identity */
+    inline const BoneTransform* GetStaticPose() const { return m_Blob.Get<BoneTransform>(m_StaticPoseOffset); }
+
+    /* tracks whose channel of the given type has more than one key */
+    inline const int* GetAnimatedTracks(ChannelType type) const
+    {
+        int first = 0;
+        for (int previous = 0; previous < type; ++previous)
+            first += m_NumAnimatedTracks[previous];
+        return m_Blob.Get<int>(m_AnimatedTracksOffset) + first;
+    }
+    inline int GetNumAnimatedTracks(ChannelType type) const { return m_NumAnimatedTracks[type]; }
+
+    /* a track none of whose channels is animated */
+    inline bool IsStaticTrack(int track) const
+    {
+        const TrackRange& range = GetTrack(track);
+        return range.position.numKeys <= 1 && range.rotation.numKeys <= 1 && range.scale.numKeys <= 1;
+    }
+    inline size_t GetSizeInBytes() const { return m_Blob.GetSizeInBytes(); }
+
+private:
+    SectionBlob m_Blob;
+    size_t m_TracksOffset = 0;
+    size_t m_TimesOffset = 0;
+    size_t m_PositionsOffset = 0;
+    size_t m_RotationsOffset = 0;
+    size_t m_ScalesOffset = 0;
+    size_t m_StaticPoseOffset = 0;
+    size_t m_AnimatedTracksOffset = 0;
+    int m_NumTracks = 0;
+    int m_NumAnimatedTracks[NumChannelTypes] = {};
+    float m_InvSampleInterval = 0.0f;
+
+    void BuildStaticPose()
+    {
+        BoneTransform* pose = m_Blob.Get<BoneTransform>(m_StaticPoseOffset);
+        int* animated = m_Blob.Get<int>(m_AnimatedTracksOffset);
+        int* animatedPositions = animated;
+        int* animatedRotations = animatedPositions + m_NumAnimatedTracks[PositionChannel];
+        int* animatedScales = animatedRotations + m_NumAnimatedTracks[RotationChannel];
+        for (int track = 0; track < m_NumTracks; ++track)
+        {
+            const TrackRange& range = GetTrack(track);
+            pose[track] = BoneTransform();
+            if (range.position.numKeys > 1)
+                *animatedPositions++ = track;
+            else if (range.position.numKeys == 1)
+                pose[track].translation = GetPositions()[range.position.keyOffset];
+
+            if (range.rotation.numKeys > 1)
+                *animatedRotations++ = track;
+            else if (range.rotation.numKeys == 1)
+                pose[track].rotation = glm::normalize(GetRotations()[range.rotation.keyOffset]);
+
+            if (range.scale.numKeys > 1)
+                *animatedScales++ = track;
+            else if (range.scale.numKeys == 1)
+                pose[track].scale = GetScales()[range.scale.keyOffset];
+        }
+    }
+
+    /* flips keys so that consecutive rotations lie in the same hemisphere. slerp does
+       this itself, but it lets samplers interpolate rotations with a plain nlerp. */
+    void AlignHemispheres(const ChannelRange& channel)
+    {
+        glm::quat* rotations = m_Blob.Get<glm::quat>(m_RotationsOffset) + channel.keyOffset;
+        for (int key = 1; key < channel.numKeys; ++key)
+        {
+            if (glm::dot(rotations[key - 1], rotations[key]) < 0.0f)
+                rotations[key] = -rotations[key];
+        }
+    }
+
+    template <typename T>
+    ChannelRange PackChannel(const KeyChannel<T>& channel, int& timeOffset, int& keyOffset, T* values)
+    {
+        ChannelRange range;
+        range.timeOffset = timeOffset;
+        range.keyOffset = keyOffset;
+        range.numKeys = channel.Size();
+        if (range.numKeys > 0)
+        {
+            std::memcpy(m_Blob.Get<float>(m_TimesOffset) + timeOffset, channel.times.data(), range.numKeys * sizeof(float));
+            std::memcpy(values + keyOffset, channel.values.data(), range.numKeys * sizeof(T));
+        }
+        timeOffset += range.numKeys;
+        keyOffset += range.numKeys;
+        return range;
+    }
+};
+
+#endif /* animation_clip_h */
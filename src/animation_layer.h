@@ -0,0 +1,115 @@
+//
+//  animation_layer.h
+//  skeletal_animation
+//
+
+#ifndef animation_layer_h
+#define animation_layer_h
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include "pose.h"
+#include "skeleton.h"
+#include "playback_state.h"
+
+class Animation;
+
+/* per bone weights of an animation layer, one float per skeleton node, so any clip on the same
+   skeleton can use the same mask */
+class BoneMask
+{
+public:
+    BoneMask() = default;
+
+    explicit BoneMask(const Skeleton& skeleton, float weight = 0.0f)
+        : m_Weights(skeleton.GetNumNodes(), weight)
+    {
+    }
+
+    inline void SetWeight(int node, float weight) { m_Weights[node] = weight; }
+    inline float GetWeight(int node) const { return m_Weights[node]; }
+    inline const float* GetWeights() const { return m_Weights.data(); }
+    inline int GetNumNodes() const { return static_cast<int>(m_Weights.size()); }
+
+    /* sets node and everything below it, e.g. the spine for an upper body mask */
+    void SetSubtree(const Skeleton& skeleton, int node, float weight)
+    {
+        // children come after their parent, so one pass from node finds the whole subtree
+        const int* parents = skeleton.GetParents();
+        std::vector<unsigned char> inSubtree(skeleton.GetNumNodes(), 0);
+        inSubtree[node] = 1;
+        m_Weights[node] = weight;
+        for (int child = node + 1; child < skeleton.GetNumNodes(); child++)
+        {
+            if (parents[child] >= 0 && inSubtree[parents[child]])
+            {
+                inSubtree[child] = 1;
+                m_Weights[child] = weight;
+            }
+        }
+    }
+
+    /* same by node name, returns false when the skeleton has no such node */
+    bool SetSubtree(const Skeleton& skeleton, const std::string& name, float weight)
+    {
+        int node = skeleton.FindNode(name);
+        if (node < 0)
+            return false;
+        SetSubtree(skeleton, node, weight);
+        return true;
+    }
+
+private:
+    std::vector<float> m_Weights;
+};
+
+enum LayerBlendMode {
+    OverrideLayer,  // blends from the pose below towards the layer's pose
+    AdditiveLayer   // adds how far the layer's pose moved from its first frame to the pose below
+};
+
+/* a clip played on top of an Animator's own animation. the clip has to share the animator's
+   skeleton. the weight of a bone is weight times its mask weight, without a mask every bone
+   the clip animates is weighted by weight alone. */
+struct AnimationLayer {
+    const Animation* animation = nullptr;
+    LayerBlendMode mode = OverrideLayer;
+    const BoneMask* mask = nullptr;
+    float weight = 1.0f;
+    float time = 0.0f;
+    PlaybackState playback;
+    std::vector<BoneTransform> reference;  // pose at time 0 indexed by track, what additive layers add to
+};
+
+/* moves pose towards layer by weight */
+inline void BlendOverride(BoneTransform& pose, const BoneTransform& layer, float weight)
+{
+    pose.translation = glm::mix(pose.translation, layer.translation, weight);
+    pose.rotation = glm::slerp(pose.rotation, layer.rotation, weight);
+    pose.scale = glm::mix(pose.scale, layer.scale, weight);
+}
+
+/* layer / reference per axis. clips may key a bone to scale 0 to hide it, an axis the reference
+   scales to 0 has no ratio and keeps the pose below */
+inline glm::vec3 ScaleRatio(const glm::vec3& layer, const glm::vec3& reference)
+{
+    glm::vec3 ratio(1.0f);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (std::fabs(reference[axis]) > 1e-6f)
+            ratio[axis] = layer[axis] / reference[axis];
+    }
+    return ratio;
+}
+
+/* applies weight times the difference between layer and reference on top of pose */
+inline void BlendAdditive(BoneTransform& pose, const BoneTransform& layer, const BoneTransform& reference, float weight)
+{
+    pose.translation += (layer.translation - reference.translation) * weight;
+    glm::quat delta = glm::inverse(reference.rotation) * layer.rotation;
+    pose.rotation = glm::normalize(pose.rotation * glm::slerp(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), delta, weight));
+    pose.scale *= glm::mix(glm::vec3(1.0f), ScaleRatio(layer.scale, reference.scale), weight);
+}
+
+#endif /* animation_layer_h */
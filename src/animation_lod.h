@@ -0,0 +1,70 @@
+//
+//  animation_lod.h
+//  skeletal_animation
+//
+
+#ifndef animation_lod_h
+#define animation_lod_h
+
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "camera.h"
+
+/* how much animation work a character gets this frame */
+struct AnimationLOD {
+    int updateInterval = 1;        // evaluate the pose every n-th frame, hold the palette in between
+    bool dropDetailBones = false;  // detail bones (fingers, helpers) keep their bind pose
+};
+
+/* projected size thresholds, as a fraction of the screen height covered by the character's bounding sphere */
+struct AnimationLODSettings {
+    float everyFrameSize = 0.25f;   // at least this big: every frame
+    float halfRateSize = 0.12f;     // every 2nd frame
+    float quarterRateSize = 0.06f;  // every 4th frame, smaller ones every 8th
+    float detailBoneSize = 0.15f;   // below this detail bones are dropped
+};
+
+/* fraction of the screen height a sphere of radius at center covers, using the camera's vertical field of view */
+inline float ProjectedSize(const Camera& camera, const glm::vec3& center, float radius)
+{
+    float distance = std::max(glm::length(center - camera.Position), radius);
+    float halfHeight = distance * std::tan(glm::radians(camera.Zoom) * 0.5f);
+    return radius / halfHeight;
+}
+
+/* whether a sphere touches the camera's view frustum (near and far plane ignored), aspect is width / height */
+inline bool IsInView(const Camera& camera, const glm::vec3& center, float radius, float aspect)
+{
+    glm::vec3 offset = center - camera.Position;
+    float depth = glm::dot(offset, camera.Front);
+    if (depth < -radius)
+        return false;
+
+    // each side plane is tilted by the half angle, so the sphere center may lie radius / cos(angle) beyond it
+    float tanHalfHeight = std::tan(glm::radians(camera.Zoom) * 0.5f);
+    float tanHalfWidth = tanHalfHeight * aspect;
+    float x = std::abs(glm::dot(offset, camera.Right));
+    float y = std::abs(glm::dot(offset, camera.Up));
+    return x <= depth * tanHalfWidth + radius * std::sqrt(1.0f + tanHalfWidth * tanHalfWidth) &&
+           y <= depth * tanHalfHeight + radius * std::sqrt(1.0f + tanHalfHeight * tanHalfHeight);
+}
+
+inline AnimationLOD SelectAnimationLOD(const Camera& camera, const glm::vec3& center, float radius,
+                                       const AnimationLODSettings& settings)
+{
+    float size = ProjectedSize(camera, center, radius);
+    AnimationLOD lod;
+    if (size >= settings.everyFrameSize)
+        lod.updateInterval = 1;
+    else if (size >= settings.halfRateSize)
+        lod.updateInterval = 2;
+    else if (size >= settings.quarterRateSize)
+        lod.updateInterval = 4;
+    else
+        lod.updateInterval = 8;
+    lod.dropDetailBones = size < settings.detailBoneSize;
+    return lod;
+}
+
+#endif /* animation_lod_h */
@@ -0,0 +1,172 @@
+//
+//  animation_scheduler.h
+//  skeletal_animation
+//
+
+#ifndef animation_scheduler_h
+#define animation_scheduler_h
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "animation_system.h"
+#include "animation_lod.h"
+#include "camera.h"
+
+/* what the last AnimationScheduler::Update did */
+struct AnimationSchedulerStats {
+    int updated = 0;        // animators that evaluated their pose
+    int skipped = 0;        // animators deferred to a later frame, still holding an older pose
+    int maxStaleness = 0;   // frames since the oldest pose still on screen was evaluated
+    float milliseconds = 0.0f;
+};
+
+/* time slices the animators of an AnimationSystem under a per frame budget. every animator's
+   playhead advances each frame, but poses are evaluated in priority order only until the budget
+   is spent, the rest keep their last pose and grow older. priority is the projected size on
+   screen, scaled down for animators outside the view and up with the number of frames their
+   pose has been stale, so every animator gets its turn eventually.
+
+   the budget is filled in batches sized from the measured cost per animator, which keeps a sudden
+   jump in crowd size from turning into a spike in frame time. the first ChunkSize animators in
+   priority order are evaluated every frame even when advancing and sorting the crowd already
+   used up the budget, so the most important poses never stop updating. */
+class AnimationScheduler
+{
+public:
+    /* priority factor of animators outside the view frustum */
+    static constexpr float HiddenWeight = 0.1f;
+
+    explicit AnimationScheduler(AnimationSystem* system, float budgetMilliseconds = 2.0f)
+        : m_System(system), m_BudgetMilliseconds(budgetMilliseconds)
+    {
+    }
+
+    inline void SetBudget(float milliseconds) { m_BudgetMilliseconds = milliseconds; }
+    inline float GetBudget() const { return m_BudgetMilliseconds; }
+    /* width / height of the viewport, for the visibility test */
+    inline void SetAspect(float aspect) { m_Aspect = aspect; }
+    inline const AnimationSchedulerStats& GetStats() const { return m_Stats; }
+    /* frames since the pose of an animator was evaluated */
+    inline int GetStaleness(int index) const { return m_Staleness[index]; }
+
+    void Update(float dt, const Camera& camera)
+    {
+        auto start = std::chrono::steady_clock::now();
+        int numAnimators = m_System->GetNumAnimators();
+        // a new animator counts as one frame stale, ahead of a fresh one of the same size
+        m_Staleness.resize(numAnimators, 1);
+        m_Priorities.resize(numAnimators);
+        m_DropDetailBones.resize(numAnimators);
+        m_Order.resize(numAnimators);
+        if (m_System->GetPoseCache())
+            m_System->GetPoseCache()->BeginFrame();
+
+        for (int i = 0; i < numAnimators; i++)
+        {
+            m_System->GetAnimator(i).AdvanceTime(dt);
+
+            const glm::vec4& bounds = m_System->GetBounds(i);
+            glm::vec3 center(bounds);
+            float size = ProjectedSize(camera, center, bounds.w);
+            float visibility = HiddenWeight;
+            if (IsInView(camera, center, bounds.w, m_Aspect))
+                visibility = 1.0f;
+            m_Priorities[i] = size * visibility * (1.0f + m_Staleness[i]);
+            m_DropDetailBones[i] = size < m_System->GetLODSettings().detailBoneSize;
+            m_Order[i] = i;
+        }
+
+        // only the animators expected to fit into the budget are sorted, with some margin
+        double budget = m_BudgetMilliseconds;
+        int sorted = numAnimators;
+        if (m_CostPerAnimator > 0.0)
+            sorted = std::min(numAnimators, static_cast<int>(2.0 * budget / m_CostPerAnimator) + AnimationSystem::ChunkSize);
+        SortByPriority(0, sorted);
+
+        int next = 0;
+        while (next < numAnimators)
+        {
+            double elapsed = Milliseconds(start);
+            if (next > 0 && elapsed >= budget)
+                break;
+            if (next == sorted)
+            {
+                SortByPriority(sorted, numAnimators);
+                sorted = numAnimators;
+            }
+
+            int batch = AnimationSystem::ChunkSize;
+            if (m_CostPerAnimator > 0.0)
+                batch = std::max(next == 0 ? batch : 1, static_cast<int>((budget - elapsed) / m_CostPerAnimator));
+            batch = std::min(batch, sorted - next);
+
+            auto batchStart = std::chrono::steady_clock::now();
+            EvaluateBatch(next, batch);
+            double cost = Milliseconds(batchStart) / batch;
+            m_CostPerAnimator = m_CostPerAnimator > 0.0 ? 0.75 * m_CostPerAnimator + 0.25 * cost : cost;
+            next += batch;
+        }
+
+        for (int i = 0; i < next; i++)
+            m_Staleness[m_Order[i]] = 0;
+        m_Stats.maxStaleness = 0;
+        for (int i = next; i < numAnimators; i++)
+        {
+            int& staleness = m_Staleness[m_Order[i]];
+            staleness++;
+            m_Stats.maxStaleness = std::max(m_Stats.maxStaleness, staleness);
+        }
+        m_Stats.updated = next;
+        m_Stats.skipped = numAnimators - next;
+        m_Stats.milliseconds = static_cast<float>(Milliseconds(start));
+    }
+
+private:
+    AnimationSystem* m_System;
+    float m_BudgetMilliseconds;
+    float m_Aspect = 800.0f / 600.0f;
+    double m_CostPerAnimator = 0.0;  // wall clock per evaluated animator, all threads together
+    AnimationSchedulerStats m_Stats;
+    std::vector<int> m_Staleness;
+    std::vector<float> m_Priorities;
+    std::vector<unsigned char> m_DropDetailBones;
+    std::vector<int> m_Order;
+
+    /* fills m_Order[first, last) with the highest priorities of m_Order[first, end), highest first.
+       ties keep index order so the schedule does not depend on the sort implementation. */
+    void SortByPriority(int first, int last)
+    {
+        auto higher = [this](int a, int b) {
+            if (m_Priorities[a] > m_Priorities[b])
+                return true;
+            if (m_Priorities[b] > m_Priorities[a])
+                return false;
+            return a < b;
+        };
+        auto begin = m_Order.begin();
+        if (last < static_cast<int>(m_Order.size()))
+            std::nth_element(begin + first, begin + last, m_Order.end(), higher);
+        std::sort(begin + first, begin + last, higher);
+    }
+
+    void EvaluateBatch(int first, int count)
+    {
+        JobSystem* jobs = m_System->GetJobSystem();
+        auto evaluate = [this, first](int begin, int end) {
+            for (int i = first + begin; i < first + end; i++)
+                m_System->GetAnimator(m_Order[i]).EvaluatePose(m_DropDetailBones[m_Order[i]] != 0);
+        };
+        if (jobs)
+            jobs->ParallelFor(count, AnimationSystem::ChunkSize, evaluate);
+        else
+            evaluate(0, count);
+    }
+
+    static double Milliseconds(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+};
+
+#endif /* animation_scheduler_h */
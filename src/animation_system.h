@@ -0,0 +1,123 @@
+//
+//  animation_system.h
+//  skeletal_animation
+//
+
+#ifndef animation_system_h
+#define animation_system_h
+
+#include <vector>
+#include <atomic>
+#include "animator.h"
+#include "animation_lod.h"
+#include "camera.h"
+#include "job_system.h"
+#include "pose_cache.h"
+
+/* owns the animators of every character and updates them as one batch. animators are kept
+   contiguous and handed to the JobSystem in chunks of ChunkSize neighbours. each animator only
+   writes its own playback state and bone matrices while the shared Animation is read-only, so
+   the matrices are bit identical whatever the number of threads.
+
+   given a camera, every character gets an AnimationLOD from the projected size of its bounding
+   sphere: far characters evaluate every 2nd, 4th or 8th frame and drop their detail bones.
+
+   with a PoseCache, characters playing the same clip at the same time share one evaluation. */
+class AnimationSystem
+{
+public:
+    static const int ChunkSize = 16;
+
+    /* without a JobSystem every animator is updated on the calling thread */
+    explicit AnimationSystem(JobSystem* jobs = nullptr) : m_Jobs(jobs)
+    {
+    }
+
+    /* returns the index of the new animator */
+    int AddAnimator(const Animation* animation)
+    {
+        int index = static_cast<int>(m_Animators.size());
+        m_Animators.push_back(Animator(animation));
+        m_Animators.back().setUpdatePhase(index);
+        m_Animators.back().setPoseCache(m_PoseCache);
+        m_Bounds.push_back(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        m_LODs.push_back(AnimationLOD());
+        return index;
+    }
+
+    /* world space bounding sphere of a character, used to pick its LOD */
+    void SetBounds(int index, const glm::vec3& center, float radius)
+    {
+        m_Bounds[index] = glm::vec4(center, radius);
+    }
+
+    inline const glm::vec4& GetBounds(int index) const { return m_Bounds[index]; }
+    inline Animator& GetAnimator(int index) { return m_Animators[index]; }
+    inline int GetNumAnimators() const { return static_cast<int>(m_Animators.size()); }
+    inline void SetJobSystem(JobSystem* jobs) { m_Jobs = jobs; }
+    inline JobSystem* GetJobSystem() const { return m_Jobs; }
+    inline PoseCache* GetPoseCache() const { return m_PoseCache; }
+    inline void SetLODSettings(const AnimationLODSettings& settings) { m_LODSettings = settings; }
+    inline const AnimationLODSettings& GetLODSettings() const { return m_LODSettings; }
+    inline const AnimationLOD& GetLOD(int index) const { return m_LODs[index]; }
+    /* animators that evaluated their pose during the last Update */
+    inline int GetNumEvaluated() const { return m_NumEvaluated; }
+
+    /* shares poses between the animators through cache, nullptr turns sharing off */
+    void SetPoseCache(PoseCache* cache)
+    {
+        m_PoseCache = cache;
+        for (Animator& animator : m_Animators)
+            animator.setPoseCache(cache);
+    }
+
+    /* updates every animator at full rate */
+    void Update(float dt)
+    {
+        Update(dt, nullptr);
+    }
+
+    /* updates every animator with the LOD its projected size on camera calls for */
+    void Update(float dt, const Camera* camera)
+    {
+        m_NumEvaluated = 0;
+        if (m_PoseCache)
+            m_PoseCache->BeginFrame();
+        if (!m_Jobs)
+        {
+            UpdateRange(0, GetNumAnimators(), dt, camera);
+            return;
+        }
+        // the job only captures this, small enough for std::function to store without allocating
+        m_UpdateDeltaTime = dt;
+        m_UpdateCamera = camera;
+        m_Jobs->ParallelFor(GetNumAnimators(), ChunkSize, [this](int begin, int end) {
+            UpdateRange(begin, end, m_UpdateDeltaTime, m_UpdateCamera);
+        });
+    }
+
+private:
+    JobSystem* m_Jobs;
+    PoseCache* m_PoseCache = nullptr;
+    std::vector<Animator> m_Animators;
+    std::vector<glm::vec4> m_Bounds;  // center and radius
+    std::vector<AnimationLOD> m_LODs;
+    AnimationLODSettings m_LODSettings;
+    std::atomic<int> m_NumEvaluated{0};
+    float m_UpdateDeltaTime = 0.0f;
+    const Camera* m_UpdateCamera = nullptr;
+
+    void UpdateRange(int begin, int end, float dt, const Camera* camera)
+    {
+        int numEvaluated = 0;
+        for (int i = begin; i < end; i++)
+        {
+            m_LODs[i] = camera ? SelectAnimationLOD(*camera, glm::vec3(m_Bounds[i]), m_Bounds[i].w, m_LODSettings)
+                               : AnimationLOD();
+            numEvaluated += m_Animators[i].UpdateAnimation(dt, m_LODs[i]);
+        }
+        m_NumEvaluated += numEvaluated;
+    }
+};
+
+#endif /* animation_system_h */
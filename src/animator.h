@@ -14,6 +14,12 @@
 #include <assimp/Importer.hpp>
 #include "animation.h"
 #include "bone.h"
+#include "batch_sampler.h"
+#include "animation_lod.h"
+#include "pose_cache.h"
+#include "baked_animation.h"
+#include "animation_layer.h"
+#include "pose_blend.h"
 
 extern int item_current;
 extern bool isPlayingAnimation;
@@ -23,86 +29,634 @@ extern const char* const* cstr_animation_items;
 class Animator
 {
 public:
-    Animator (Animation* animation)
+    Animator (const Animation* animation)
     {
         m_CurrentTime = 0.0;
+        m_SampleTime = 0.0;
         m_CurrentAnimation = animation;
         
-        m_FinalBoneMatrices.reserve(100);
+        m_FinalBoneMatrices.reserve(MAX_BONES);
         
-        for (int i = 0; i < 100; i++)
+        for (int i = 0; i < MAX_BONES; i++)
             m_FinalBoneMatrices.push_back(glm::mat4(1.0f));
     }
     
-    void UpdateAnimation(float dt)
+    /* advances the playhead every call, but only evaluates the pose on the frames the LOD's update
+       interval asks for and holds the last bone matrices in between. returns whether it evaluated. */
+    bool UpdateAnimation(float dt, const AnimationLOD& lod = AnimationLOD())
+    {
+        if (!m_CurrentAnimation)
+            return false;
+        AdvanceTime(dt);
+
+        // intervals are powers of two, so instances with different phases spread over the frames
+        unsigned int frame = m_FrameIndex++;
+        int interval = std::max(lod.updateInterval, 1);
+        if (m_HasPose && (frame + m_UpdatePhase) % interval != 0)
+            return false;
+        EvaluatePose(lod.dropDetailBones);
+        return true;
+    }
+
+    /* moves the playhead without touching the pose */
+    void AdvanceTime(float dt)
     {
         m_DeltaTime = dt;
-        if (m_CurrentAnimation)
+        if (!m_CurrentAnimation)
+            return;
+        m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt;
+        m_CurrentTime = fmod(m_CurrentTime, m_CurrentAnimation->GetDuration());
+        for (AnimationLayer& layer : m_Layers)
+        {
+            layer.time += layer.animation->GetTicksPerSecond() * dt;
+            layer.time = fmod(layer.time, layer.animation->GetDuration());
+        }
+        if (m_FadeSource)
+        {
+            m_FadeElapsed += dt;
+            m_FadeSourceTime += m_FadeSource->GetTicksPerSecond() * dt;
+            m_FadeSourceTime = fmod(m_FadeSourceTime, m_FadeSource->GetDuration());
+            if (m_FadeElapsed >= m_FadeDuration)
+                m_FadeSource = nullptr;
+        }
+    }
+
+    /* samples the clip at the playhead and rebuilds the bone matrices. does nothing when none of
+       the inputs of the pose changed since the last call, e.g. while the animation is paused.
+       with a PoseCache the pose is copied from an animator that already evaluated it this frame,
+       with a BakedAnimation of the clip a full playing pose is read from its table. layered,
+       blended and cross-fading poses are evaluated every call. */
+    void EvaluatePose(bool dropDetailBones = false)
+    {
+        if (!m_CurrentAnimation)
+            return;
+        if (IsLayered() || IsBlended())
         {
-            m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt;
-            m_CurrentTime = fmod(m_CurrentTime, m_CurrentAnimation->GetDuration());
-            CalculateBoneTransform(&m_CurrentAnimation->GetRootNode(), glm::mat4(1.0f));
+            EvaluateBlendedPose(dropDetailBones);
+            return;
         }
+
+        float sampleTime = m_CurrentTime;
+        if (m_PoseCache)
+            sampleTime = m_PoseCache->QuantizeTime(m_CurrentTime, m_CurrentAnimation->GetDuration());
+        PoseKey key;
+        key.animation = m_CurrentAnimation;
+        key.playing = IsPlaying();
+        if (IsPlaying())
+            key.time = PoseCache::TimeKey(sampleTime, m_PoseCache ? m_PoseCache->GetTimeStep() : 0.0f);
+        key.playedTrack = IsPlayingSingleBone() ? m_CurrentPlayedTrack : -2;
+        key.dropDetailBones = dropDetailBones;
+        if (m_HasPose && key == m_EvaluatedKey)
+            return;
+        m_EvaluatedKey = key;
+        m_HasPose = true;
+
+        bool baked = m_BakedAnimation && m_BakedAnimation->GetAnimation() == m_CurrentAnimation &&
+                     IsPlaying() && !IsPlayingSingleBone();
+        if (baked)
+            m_BakedAnimation->Sample(sampleTime, m_InterpolateBaked, m_FinalBoneMatrices);
+        if (baked || (m_PoseCache && m_PoseCache->Fetch(key, m_FinalBoneMatrices)))
+        {
+            // the model transforms were not computed, the next evaluation starts over
+            m_FullUpdate = true;
+            m_NumDirtyNodes = 0;
+            m_PoseVersion++;
+            return;
+        }
+
+        // float clips sample all bones in one batch, compressed clips bone by bone
+        m_UseBatchSampler = m_CurrentAnimation->GetClip().GetNumTracks() > 0;
+        if (!m_Playback.IsBoundTo(m_CurrentAnimation))
+            m_CurrentAnimation->BindPlayback(m_Playback);
+        m_SampleTime = sampleTime;
+        if (m_UseBatchSampler && IsPlaying())
+            BatchSampler::Sample(m_CurrentAnimation->GetClip(), m_SampleTime, m_Playback);
+        CalculateBoneTransform(dropDetailBones);
+        if (m_PoseCache)
+            m_PoseCache->Store(key, m_FinalBoneMatrices);
     }
     
-    void PlayAnimation(Animation* pAnimation)
+    void PlayAnimation(const Animation* pAnimation)
     {
         m_CurrentAnimation = pAnimation;
         m_CurrentTime = 0;
+        m_HasPose = false;
+        m_FadeSource = nullptr;
+        // track indices belong to the previous animation
+        m_CurrentPlayedTrack = -1;
+        // layers and blend clips stay as long as they share the new animation's skeleton
+        for (int layer = GetNumLayers() - 1; layer >= 0; layer--)
+        {
+            if (!pAnimation || !pAnimation->GetSkeleton().Matches(m_Layers[layer].animation->GetSkeleton()))
+                RemoveLayer(layer);
+        }
+        for (int clip = static_cast<int>(m_BlendClips.size()) - 1; clip >= 0; clip--)
+        {
+            if (!pAnimation || !pAnimation->GetSkeleton().Matches(m_BlendClips[clip].animation->GetSkeleton()))
+                m_BlendClips.erase(m_BlendClips.begin() + clip);
+        }
+    }
+
+    /* starts pAnimation from the beginning and blends over to it from the current pose during
+       seconds. switches at once when there is nothing to fade from or the skeletons differ. */
+    void CrossFade(const Animation* pAnimation, float seconds)
+    {
+        const Animation* previous = m_CurrentAnimation;
+        float previousTime = m_CurrentTime;
+        PlayAnimation(pAnimation);
+        if (!previous || !pAnimation || seconds <= 0.0f || !previous->GetSkeleton().Matches(pAnimation->GetSkeleton()))
+            return;
+
+        // the outgoing clip keeps its playhead and cursors, the new one starts bound afresh
+        m_FadeSource = previous;
+        m_FadeSourceTime = previousTime;
+        std::swap(m_FadePlayback, m_Playback);
+        m_FadeDuration = seconds;
+        m_FadeElapsed = 0.0f;
+    }
+
+    inline bool IsCrossFading() const { return m_FadeSource != nullptr; }
+
+    /* blends animation with the animator's own animation, e.g. walk and run of a blend space.
+       every clip plays at the same fraction of its duration as the animator's animation. weights
+       are relative and not negative, index 0 is the animator's own animation, which starts at
+       weight 1. returns the index of the clip, or -1 when animation does not share the animator's
+       skeleton. */
+    int AddBlendClip(const Animation* animation, float weight)
+    {
+        if (!m_CurrentAnimation || !animation || !animation->GetSkeleton().Matches(m_CurrentAnimation->GetSkeleton()))
+            return -1;
+        m_BlendClips.push_back(BlendClip());
+        m_BlendClips.back().animation = animation;
+        m_BlendClips.back().weight = std::max(weight, 0.0f);
+        animation->BindPlayback(m_BlendClips.back().playback);
+        // per frame blending reuses these
+        m_BlendInputs.resize(m_BlendClips.size() + 1);
+        m_BlendWeights.resize(m_BlendClips.size() + 1);
+        return static_cast<int>(m_BlendClips.size());
+    }
+
+    void ClearBlendClips()
+    {
+        m_BlendClips.clear();
+        m_HasPose = false;
+    }
+
+    /* negative weights count as 0 */
+    void setBlendWeight(int clip, float weight)
+    {
+        weight = std::max(weight, 0.0f);
+        if (clip == 0)
+            m_BlendWeight = weight;
+        else
+            m_BlendClips[clip - 1].weight = weight;
+    }
+
+    /* plays animation on top of the animator's own one, masked per bone by mask (nullptr for
+       every bone). layers apply in the order they were added. returns the index of the layer,
+       or -1 when animation does not share the skeleton of the animator's animation. */
+    int AddLayer(const Animation* animation, LayerBlendMode mode, const BoneMask* mask = nullptr, float weight = 1.0f)
+    {
+        if (!m_CurrentAnimation || !animation || !animation->GetSkeleton().Matches(m_CurrentAnimation->GetSkeleton()))
+            return -1;
+        m_Layers.push_back(AnimationLayer());
+        AnimationLayer& layer = m_Layers.back();
+        layer.animation = animation;
+        layer.mode = mode;
+        layer.mask = mask;
+        layer.weight = weight;
+        animation->BindPlayback(layer.playback);
+        layer.reference = layer.playback.localPose;
+        for (int track = 0; track < animation->GetNumTracks(); track++)
+        {
+            KeyframeCursor cursor;
+            animation->GetBone(track).Sample(0.0f, cursor, layer.reference[track]);
+        }
+        m_LayerTracks.resize(m_Layers.size());
+        m_LayerWeights.resize(m_Layers.size());
+        return GetNumLayers() - 1;
+    }
+
+    void RemoveLayer(int layer)
+    {
+        m_Layers.erase(m_Layers.begin() + layer);
+        m_HasPose = false;
+    }
+
+    inline int GetNumLayers() const { return static_cast<int>(m_Layers.size()); }
+
+    void setLayerWeight(int layer, float weight)
+    {
+        m_Layers[layer].weight = weight;
+    }
+
+    void setLayerTime(int layer, float time)
+    {
+        m_Layers[layer].time = time;
+    }
+
+    /* plays with this mode instead of the isPlayingAnimation and isPlayingSingleBone globals the
+       UI of main.cpp toggles, for animators that evaluate poses on their own like the bake */
+    void setPlayMode(bool playing, bool singleBone)
+    {
+        m_OwnPlayMode = true;
+        m_Playing = playing;
+        m_PlayingSingleBone = singleBone;
+    }
+
+    /* offsets the frames on which reduced rate LODs evaluate, so a crowd does not update in lockstep */
+    void setUpdatePhase(unsigned int phase)
+    {
+        m_UpdatePhase = phase;
     }
     
-    void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
+    /* model space transform of every skeleton node. nodes are stored parent first, so one
+       forward pass sees every parent before its children. with dropDetailBones the detail
+       nodes of the animation are left in their bind pose.
+
+       a node is dirty when its parent is dirty or when its local transform may have changed since
+       it was last concatenated: the sampler rewrote its track, or it switched between its track
+       and the bind pose. static tracks are never rewritten, so their nodes stay clean. layered
+       and blended poses are mixed per node on every evaluation, those still compare each node's
+       TRS with the one it was last concatenated with. only dirty nodes are re-concatenated and
+       only their palette entries rewritten, so a single animated bone costs its subtree, not the
+       skeleton. */
+    void CalculateBoneTransform(bool dropDetailBones = false)
     {
-        std::string nodeName = node->name;
-        glm::mat4 nodeTransform = node->transformation;
-        
-        Bone* bone = m_CurrentAnimation->FindBone(nodeName);
-        if (bone)
+        const Skeleton& skeleton = m_CurrentAnimation->GetSkeleton();
+        const int* parents = skeleton.GetParents();
+        const glm::mat4* bindTransforms = skeleton.GetBindTransforms();
+        int numNodes = skeleton.GetNumNodes();
+        if (m_EvaluatedAnimation != m_CurrentAnimation || static_cast<int>(m_ModelTransforms.size()) != numNodes)
+        {
+            m_EvaluatedAnimation = m_CurrentAnimation;
+            m_ModelTransforms.resize(numNodes);
+            m_AppliedPoses.resize(numNodes);
+            m_AppliedBindPose.assign(numNodes, 0);
+            m_DirtyNodes.assign(numNodes, 1);
+            m_LayeredPoses.resize(numNodes);
+            m_FullUpdate = true;
+        }
+        m_NumDirtyNodes = 0;
+        bool paletteChanged = false;
+        bool layered = IsLayered();
+        bool blended = IsBlended();
+        // mixed poses are tracked by comparing them, switching to or from them starts over
+        bool mixed = layered || blended;
+        if (mixed != m_EvaluatedMixed)
+        {
+            m_EvaluatedMixed = mixed;
+            m_FullUpdate = true;
+        }
+
+        const int* nodeTracks = m_CurrentAnimation->GetNodeTracks();
+        const int* nodeSlots = m_CurrentAnimation->GetNodeSlots();
+        const glm::mat4* nodeOffsets = m_CurrentAnimation->GetNodeOffsets();
+        const unsigned char* detailNodes = m_CurrentAnimation->GetDetailNodes();
+
+        for (int node = 0; node < numNodes; node++)
         {
-            if (isPlayingAnimation)
+            const BoneTransform* localPose = nullptr;
+            bool sampled = false;
+
+            int track = nodeTracks[node];
+            bool dropped = dropDetailBones && detailNodes[node];
+            if (layered && !dropped)
+            {
+                localPose = BlendLayers(node, track);
+            }
+            else if (blended && !dropped)
+            {
+                localPose = &m_BlendedPoses[node];
+            }
+            else if (track >= 0 && !dropped)
             {
-                if ((!isPlayingSingleBone) || (isPlayingSingleBone && currentPlayedBone == bone->GetBoneName()))
+                if (IsPlaying())
                 {
-                    bone->Update(m_CurrentTime);
-                    nodeTransform = bone->GetLocalTransform();
+                    if ((!IsPlayingSingleBone()) || (IsPlayingSingleBone() && m_CurrentPlayedTrack == track))
+                    {
+                        const Bone& bone = m_CurrentAnimation->GetBone(track);
+                        if (!m_UseBatchSampler)
+                            bone.Sample(m_SampleTime, m_Playback.cursors[track], m_Playback.localPose[track]);
+                        localPose = &m_Playback.localPose[track];
+                        // either sampler rewrites every animated track and never touches static ones
+                        sampled = !bone.IsStatic();
+                    }
                 }
             }
-        }
 
-        glm::mat4 globalTransformation = parentTransform * nodeTransform;
+            int parent = parents[node];
+            bool dirty = m_FullUpdate || (parent >= 0 && m_DirtyNodes[parent]) || sampled ||
+                         (localPose == nullptr) != (m_AppliedBindPose[node] != 0) ||
+                         (mixed && LocalPoseChanged(node, localPose));
+            m_DirtyNodes[node] = dirty;
+            if (!dirty)
+                continue;
+            m_NumDirtyNodes++;
+            m_AppliedBindPose[node] = localPose == nullptr;
+            if (localPose && mixed)
+                m_AppliedPoses[node] = *localPose;
 
-        auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-        if (boneInfoMap.find(nodeName) != boneInfoMap.end())
-        {
-            std::string newNode = nodeName;
-            int index = boneInfoMap[newNode].id;
-            glm::mat4 offset = boneInfoMap[newNode].offset;
+            // animated bones turn their TRS into a matrix only here, while concatenating
+            glm::mat4& globalTransformation = m_ModelTransforms[node];
+            if (parents[node] < 0)
+                globalTransformation = localPose ? localPose->ToMatrix() : bindTransforms[node];
+            else if (localPose)
+                globalTransformation = ConcatenateTransform(m_ModelTransforms[parents[node]], *localPose);
+            else
+                globalTransformation = m_ModelTransforms[parents[node]] * bindTransforms[node];
 
-            m_FinalBoneMatrices[index] = globalTransformation * offset;
-        }
-
-        for (int i = 0; i < node->childrenCount; i++)
-        {
-            CalculateBoneTransform(&node->children[i], globalTransformation);
+            int slot = nodeSlots[node];
+            if (slot >= 0)
+            {
+                m_FinalBoneMatrices[slot] = globalTransformation * nodeOffsets[node];
+                paletteChanged = true;
+            }
         }
-        
+        m_FullUpdate = false;
+        if (paletteChanged)
+            m_PoseVersion++;
     }
+
+    /* increases whenever GetFinalBoneMatrices() changes, renderers only upload the palette when
+       it differs from the version they uploaded last */
+    inline unsigned int GetPoseVersion() const { return m_PoseVersion; }
+
+    /* nodes re-concatenated by the last CalculateBoneTransform */
+    inline int GetNumDirtyNodes() const { return m_NumDirtyNodes; }
+
     std::vector<glm::mat4>& GetFinalBoneMatrices()
     {
         return m_FinalBoneMatrices;
     }
      
-    void setCurrentPlayedBone(std::string bone)
+    /* shares evaluated poses with the other animators using cache, nullptr evaluates every pose */
+    void setPoseCache(PoseCache* cache)
+    {
+        m_PoseCache = cache;
+    }
+
+    /* plays the clip baked into baked instead of sampling it whenever all bones play, with
+       interpolate a lerp of the two nearest frames, else the nearest one. nullptr samples live. */
+    void setBakedAnimation(const BakedAnimation* baked, bool interpolate = true)
+    {
+        m_BakedAnimation = baked;
+        m_InterpolateBaked = interpolate;
+        m_HasPose = false;
+    }
+
+    /* moves the playhead, e.g. to start instances sharing a clip at different phases */
+    void setCurrentTime(float time)
     {
-        currentPlayedBone = bone;
+        m_CurrentTime = time;
+    }
+
+    void setCurrentPlayedBone(const std::string& bone)
+    {
+        m_CurrentPlayedTrack = m_CurrentAnimation ? m_CurrentAnimation->FindTrack(bone) : -1;
+    }
+
+    /* same as setCurrentPlayedBone with the bone's track index, no name lookup */
+    void setCurrentPlayedTrack(int track)
+    {
+        m_CurrentPlayedTrack = track;
     }
     
 private:
     std::vector<glm::mat4> m_FinalBoneMatrices;
-    std::string currentPlayedBone;
-    Animation* m_CurrentAnimation;
+    std::vector<glm::mat4> m_ModelTransforms;
+    // cursors and local pose of this instance, the Animation is shared and read-only
+    PlaybackState m_Playback;
+    bool m_UseBatchSampler = false;
+    int m_CurrentPlayedTrack = -1;
+    const Animation* m_CurrentAnimation;
     float m_CurrentTime;
+    float m_SampleTime;  // m_CurrentTime of the last evaluation, snapped to the pose cache's time step
     float m_DeltaTime;
+    // what every node was last concatenated with, to find the dirty subtrees
+    const Animation* m_EvaluatedAnimation = nullptr;
+    std::vector<BoneTransform> m_AppliedPoses;
+    std::vector<unsigned char> m_AppliedBindPose;
+    std::vector<unsigned char> m_DirtyNodes;
+    bool m_FullUpdate = true;
+    bool m_EvaluatedMixed = false;  // whether the nodes were last concatenated with layered or blended poses
+    int m_NumDirtyNodes = 0;
+    unsigned int m_PoseVersion = 0;
+    // inputs of the current palette, to skip evaluations that would not change it
+    PoseKey m_EvaluatedKey;
+    PoseCache* m_PoseCache = nullptr;
+    const BakedAnimation* m_BakedAnimation = nullptr;
+    bool m_InterpolateBaked = true;
+    std::vector<AnimationLayer> m_Layers;
+    std::vector<BoneTransform> m_LayeredPoses;  // indexed by node
+    // track and weight of every layer for the node being blended
+    std::vector<int> m_LayerTracks;
+    std::vector<float> m_LayerWeights;
+    // cross-fade from the previous animation
+    const Animation* m_FadeSource = nullptr;
+    float m_FadeSourceTime = 0.0f;
+    float m_FadeDuration = 0.0f;
+    float m_FadeElapsed = 0.0f;
+    PlaybackState m_FadePlayback;
+    // clips blended with the animation, see AddBlendClip
+    struct BlendClip {
+        const Animation* animation = nullptr;
+        float weight = 0.0f;
+        PlaybackState playback;
+    };
+    std::vector<BlendClip> m_BlendClips;
+    float m_BlendWeight = 1.0f;
+    std::vector<const BoneTransform*> m_BlendInputs;
+    std::vector<float> m_BlendWeights;
+    std::vector<BoneTransform> m_BlendedPoses;  // indexed by node
+    unsigned int m_FrameIndex = 0;
+    unsigned int m_UpdatePhase = 0;
+    bool m_HasPose = false;
+    // set by setPlayMode, otherwise the globals apply
+    bool m_OwnPlayMode = false;
+    bool m_Playing = true;
+    bool m_PlayingSingleBone = false;
+
+    inline bool IsPlaying() const { return m_OwnPlayMode ? m_Playing : isPlayingAnimation; }
+    inline bool IsPlayingSingleBone() const { return m_OwnPlayMode ? m_PlayingSingleBone : isPlayingSingleBone; }
+
+    /* layers apply while every bone plays, the single bone view shows the animation alone */
+    inline bool IsLayered() const
+    {
+        return !m_Layers.empty() && IsPlaying() && !IsPlayingSingleBone();
+    }
+
+    /* blend clips and cross-fades apply under the same conditions as layers */
+    inline bool IsBlended() const
+    {
+        return (m_FadeSource || !m_BlendClips.empty()) && IsPlaying() && !IsPlayingSingleBone();
+    }
+
+    void EvaluateBlendedPose(bool dropDetailBones)
+    {
+        // layer and blend inputs are not part of the key, forget it so the next plain pose is evaluated
+        m_EvaluatedKey = PoseKey();
+        m_HasPose = true;
+        if (!m_Playback.IsBoundTo(m_CurrentAnimation))
+            m_CurrentAnimation->BindPlayback(m_Playback);
+        if (IsBlended())
+            BlendPose();
+        // bones are sampled one by one, only where some layer shows them
+        m_UseBatchSampler = false;
+        CalculateBoneTransform(dropDetailBones);
+    }
+
+    /* samples the animation, its blend clips and the clip faded from into scratch poses and
+       blends them into m_BlendedPoses */
+    void BlendPose()
+    {
+        int numNodes = m_CurrentAnimation->GetSkeleton().GetNumNodes();
+        m_BlendedPoses.resize(numNodes);
+        int numClips = static_cast<int>(m_BlendClips.size()) + 1;
+        PoseScratch scratch(numNodes, numClips + 1);
+
+        SamplePose(*m_CurrentAnimation, m_CurrentTime, m_Playback, scratch.Get(0));
+        BoneTransform* target = scratch.Get(0);
+        if (numClips > 1)
+        {
+            float phase = m_CurrentTime / m_CurrentAnimation->GetDuration();
+            m_BlendInputs[0] = scratch.Get(0);
+            m_BlendWeights[0] = m_BlendWeight;
+            for (int clip = 1; clip < numClips; clip++)
+            {
+                BlendClip& blendClip = m_BlendClips[clip - 1];
+                SamplePose(*blendClip.animation, phase * blendClip.animation->GetDuration(), blendClip.playback, scratch.Get(clip));
+                m_BlendInputs[clip] = scratch.Get(clip);
+                m_BlendWeights[clip] = blendClip.weight;
+            }
+            target = m_FadeSource ? scratch.Get(numClips) : m_BlendedPoses.data();
+            BlendPoses(m_BlendInputs.data(), m_BlendWeights.data(), numClips, numNodes, target);
+        }
+
+        if (m_FadeSource)
+        {
+            BoneTransform* source = target == scratch.Get(0) ? scratch.Get(numClips) : scratch.Get(1);
+            SamplePose(*m_FadeSource, m_FadeSourceTime, m_FadePlayback, source);
+            BlendPoses(source, target, m_FadeElapsed / m_FadeDuration, numNodes, m_BlendedPoses.data());
+        }
+        else if (target != m_BlendedPoses.data())
+            std::copy(target, target + numNodes, m_BlendedPoses.begin());
+    }
+
+    /* local pose of node after all layers, nullptr when neither the animation nor any layer
+       moves it. layers below the topmost override at full weight are hidden and never sampled,
+       neither are layers with zero weight. */
+    const BoneTransform* BlendLayers(int node, int track)
+    {
+        int numLayers = GetNumLayers();
+        int first = -1;
+        for (int layer = numLayers - 1; layer >= 0; layer--)
+        {
+            const AnimationLayer& current = m_Layers[layer];
+            int layerTrack = current.animation->GetNodeTracks()[node];
+            float weight = layerTrack < 0 ? 0.0f : current.weight * (current.mask ? current.mask->GetWeight(node) : 1.0f);
+            if (current.mode == OverrideLayer)
+                weight = std::min(weight, 1.0f);
+            m_LayerTracks[layer] = layerTrack;
+            m_LayerWeights[layer] = weight;
+            if (first < 0 && current.mode == OverrideLayer && weight >= 1.0f)
+                first = layer;
+        }
+
+        bool blended = IsBlended();
+        bool moved = first >= 0 || track >= 0 || blended;
+        for (int layer = first + 1; layer < numLayers && !moved; layer++)
+            moved = m_LayerWeights[layer] > 0.0f;
+        if (!moved)
+            return nullptr;
+
+        BoneTransform& pose = m_LayeredPoses[node];
+        if (first >= 0)
+            pose = SampleLayer(first, m_LayerTracks[first]);
+        else if (blended)
+            pose = m_BlendedPoses[node];
+        else if (track >= 0)
+        {
+            m_CurrentAnimation->GetBone(track).Sample(m_CurrentTime, m_Playback.cursors[track], m_Playback.localPose[track]);
+            pose = m_Playback.localPose[track];
+        }
+        else
+            pose = m_CurrentAnimation->GetSkeleton().GetBindPoses()[node];
+
+        for (int layer = first + 1; layer < numLayers; layer++)
+        {
+            float weight = m_LayerWeights[layer];
+            if (weight <= 0.0f)
+                continue;
+            int layerTrack = m_LayerTracks[layer];
+            const BoneTransform& layerPose = SampleLayer(layer, layerTrack);
+            if (m_Layers[layer].mode == OverrideLayer)
+                BlendOverride(pose, layerPose, weight);
+            else
+                BlendAdditive(pose, layerPose, m_Layers[layer].reference[layerTrack], weight);
+        }
+        return &pose;
+    }
+
+    const BoneTransform& SampleLayer(int layer, int track)
+    {
+        AnimationLayer& current = m_Layers[layer];
+        current.animation->GetBone(track).Sample(current.time, current.playback.cursors[track], current.playback.localPose[track]);
+        return current.playback.localPose[track];
+    }
+
+    bool LocalPoseChanged(int node, const BoneTransform* localPose) const
+    {
+        if (!localPose)
+            return !m_AppliedBindPose[node];
+        const BoneTransform& applied = m_AppliedPoses[node];
+        return m_AppliedBindPose[node] || localPose->translation != applied.translation ||
+               localPose->rotation != applied.rotation || localPose->scale != applied.scale;
+    }
 };
 
+/* fills every frame of baked with the full pose of its animation */
+inline void BakeAnimation(BakedAnimation& baked)
+{
+    Animator animator(baked.GetAnimation());
+    animator.setPlayMode(true, false);
+    for (int frame = 0; frame < baked.GetNumFrames(); frame++)
+    {
+        animator.setCurrentTime(baked.GetFrameTime(frame));
+        animator.EvaluatePose();
+        baked.SetFrame(frame, animator.GetFinalBoneMatrices());
+    }
+}
+
+/* compares playing baked against evaluating its animation, at numSamples times spread between the frames */
+inline BakedAnimationError MeasureBakeError(const BakedAnimation& baked, bool interpolate, int numSamples = 256)
+{
+    BakedAnimationError error;
+    Animator animator(baked.GetAnimation());
+    animator.setPlayMode(true, false);
+    std::vector<glm::mat4> palette(animator.GetFinalBoneMatrices());
+    double sumTranslation = 0.0;
+    for (int sample = 0; sample < numSamples; sample++)
+    {
+        // steps of the golden ratio keep the samples away from the baked frames
+        float time = std::fmod(sample * 0.618034f, 1.0f) * baked.GetAnimation()->GetDuration();
+        animator.setCurrentTime(time);
+        animator.EvaluatePose();
+        baked.Sample(time, interpolate, palette);
+
+        const std::vector<glm::mat4>& live = animator.GetFinalBoneMatrices();
+        for (int slot = 0; slot < baked.GetNumSlots(); slot++)
+        {
+            float translation = glm::length(glm::vec3(palette[slot][3] - live[slot][3]));
+            error.maxTranslation = std::max(error.maxTranslation, translation);
+            sumTranslation += static_cast<double>(translation);
+            for (int column = 0; column < 3; column++)
+                for (int row = 0; row < 3; row++)
+                    error.maxLinear = std::max(error.maxLinear, std::fabs(palette[slot][column][row] - live[slot][column][row]));
+        }
+    }
+    error.meanTranslation = static_cast<float>(sumTranslation / std::max(numSamples * baked.GetNumSlots(), 1));
+    return error;
+}
+
 #endif /* animator_h */
@@ -8,6 +8,7 @@
 #ifndef animdata_h
 #define animdata_h
 
+#include <iosfwd>
 #include <glm/glm.hpp>
 
 struct BoneInfo {
@@ -18,4 +19,24 @@ struct BoneInfo {
     glm::mat4 offset;
 };
 
+struct AnimationImportSettings {
+    /* resample every channel to this many keys per second (the clip's ticks per second
+       gives one key per tick), 0 keeps the keys of the source file */
+    float resampleRate = 0.0f;
+
+    /* keep the clip quantized (48 bit rotations, 16 bit translations/scales and frame indices)
+       and decode keys while sampling */
+    bool compress = false;
+
+    /* drop keys as long as every joint stays within reducePositionTolerance model units of its
+       source position in model space, 0 keeps every key. a non-zero reduceAngleTolerance
+       (radians) also caps the rotation error of every bone */
+    float reducePositionTolerance = 0.0f;
+    float reduceAngleTolerance = 0.0f;
+
+    /* where the import reports what it did to the keys, std::cout when null. not part of what
+       is imported, e.g. a tool importing on several threads collects each report apart */
+    std::ostream* log = nullptr;
+};
+
 #endif /* animdata_h */
@@ -0,0 +1,150 @@
+//
+//  asset_cooker.h
+//  skeletal_animation
+//
+
+#ifndef asset_cooker_h
+#define asset_cooker_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include "animdata.h"
+#include "import_session.h"
+#include "model_animation.h"
+#include "clip_library.h"
+#include "cooked_asset.h"
+#include "cooked_asset_writer.h"
+
+/* 64 bit FNV-1a, continues from hash */
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+inline uint64_t HashValue(const T& value, uint64_t hash)
+{
+    return HashBytes(&value, sizeof(value), hash);
+}
+
+/* how sources are imported, everything that changes the cooked output */
+struct CookSettings {
+    ImportProfile profile = ImportProfile::RuntimeMinimal();
+    AnimationImportSettings animation;
+};
+
+enum CookResult {
+    CookFailed,
+    Cooked,
+    CookUpToDate  // the output was cooked from the same source bytes with the same settings
+};
+
+/* imports sources headlessly and writes cooked assets, skipping sources whose output already
+   carries the hash of the same source bytes, settings and format version. texture files are
+   not part of the hash, cooked assets only refer to them by their path from the cooked file. */
+class AssetCooker
+{
+public:
+    explicit AssetCooker(const CookSettings& settings = CookSettings()) : m_Settings(settings)
+    {
+    }
+
+    /* a cooked asset holds meshes and the bone offsets read from them, profiles that remove the
+       meshes, like animation-only, cannot cook */
+    static bool CanCook(const ImportProfile& profile)
+    {
+        return !(profile.removeComponents & aiComponent_MESHES);
+    }
+
+    /* what source and settings hash to, 0 when source cannot be read */
+    uint64_t HashSource(const std::string& sourcePath) const
+    {
+        std::ifstream file(sourcePath, std::ios::binary);
+        if (!file)
+            return 0;
+        uint64_t hash = HashBytes(nullptr, 0);
+        std::vector<char> buffer(1 << 16);
+        while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+            hash = HashBytes(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+
+        const AnimationImportSettings& animation = m_Settings.animation;
+        hash = HashValue(static_cast<uint32_t>(CookedAsset::Version), hash);
+        hash = HashValue(static_cast<uint32_t>(m_Settings.profile.flags), hash);
+        hash = HashValue(static_cast<int32_t>(m_Settings.profile.maxBoneWeights), hash);
+        hash = HashValue(static_cast<int32_t>(m_Settings.profile.removeComponents), hash);
+        hash = HashValue(animation.resampleRate, hash);
+        hash = HashValue(static_cast<uint32_t>(animation.compress), hash);
+        hash = HashValue(animation.reducePositionTolerance, hash);
+        hash = HashValue(animation.reduceAngleTolerance, hash);
+        // 0 means unknown in a cooked header
+        return hash != 0 ? hash : 1;
+    }
+
+    /* cooks sourcePath into outputPath unless it is up to date, force cooks regardless. the
+       import stats and errors go to log, so cooks running at once can keep their reports apart */
+    CookResult Cook(const std::string& sourcePath, const std::string& outputPath, bool force = false,
+                    std::ostream& log = std::cout) const
+    {
+        if (!CanCook(m_Settings.profile))
+        {
+            log << "ERROR::COOK:: profile " << m_Settings.profile.name << " removes the meshes a cooked asset needs" << std::endl;
+            return CookFailed;
+        }
+        uint64_t hash = HashSource(sourcePath);
+        if (hash == 0)
+        {
+            log << "ERROR::COOK:: cannot read " << sourcePath << std::endl;
+            return CookFailed;
+        }
+        if (!force && CookedAsset::ReadSourceHash(outputPath) == hash)
+            return CookUpToDate;
+
+        ImportSession session(sourcePath, m_Settings.profile);
+        if (!session.IsComplete())
+        {
+            log << "ERROR::ASSIMP:: " << sourcePath << ": " << session.GetErrorString() << std::endl;
+            return CookFailed;
+        }
+        session.PrintStats(log);
+        Model model(session, false, false, &log);
+        AnimationImportSettings animation = m_Settings.animation;
+        animation.log = &log;
+        ClipLibrary clips(session, &model, animation);
+
+        // written next to the output and moved over it, so a failed cook never leaves half a file
+        std::string partialPath = outputPath + ".partial";
+        if (!WriteCookedAsset(partialPath, model, clips, hash, log))
+        {
+            std::remove(partialPath.c_str());
+            return CookFailed;
+        }
+#ifdef _WIN32
+        // rename does not replace an existing file here
+        std::remove(outputPath.c_str());
+#endif
+        if (std::rename(partialPath.c_str(), outputPath.c_str()) != 0)
+        {
+            log << "ERROR::COOK:: cannot write " << outputPath << std::endl;
+            std::remove(partialPath.c_str());
+            return CookFailed;
+        }
+        return Cooked;
+    }
+
+    inline const CookSettings& GetSettings() const { return m_Settings; }
+
+private:
+    CookSettings m_Settings;
+};
+
+#endif /* asset_cooker_h */
@@ -0,0 +1,129 @@
+//
+//  baked_animation.h
+//  skeletal_animation
+//
+
+#ifndef baked_animation_h
+#define baked_animation_h
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "animation.h"
+
+/* how far a baked palette is from the live one, in model units */
+struct BakedAnimationError {
+    float maxTranslation = 0.0f;  // largest offset of a bone's translation
+    float meanTranslation = 0.0f;
+    float maxLinear = 0.0f;       // largest difference of an element of the 3x3 part
+};
+
+/* final bone matrices of an Animation sampled at a fixed rate into one table. playing it back is
+   a fetch of one frame, or a lerp between two, no keys are searched and no hierarchy is walked.
+   every matrix is stored as its upper 3x4 rows, the last row of an affine transform is implied.
+   the first frame is at time 0 and the last one at the duration, so clips whose last key differs
+   from the first are not blended across the loop. */
+class BakedAnimation
+{
+public:
+    /* table for the full pose of animation at samplesPerSecond frames per second of playback,
+       every frame is filled in by BakeAnimation */
+    BakedAnimation(const Animation& animation, float samplesPerSecond)
+        : m_Animation(&animation)
+    {
+        m_NumSlots = CountSlots(animation);
+        m_NumFrames = CountFrames(animation, samplesPerSecond);
+        // a clip without length, e.g. a single key, holds the same pose in every frame
+        m_FramesPerTick = animation.GetDuration() > 0.0f ? (m_NumFrames - 1) / animation.GetDuration() : 0.0f;
+        m_Table.resize(static_cast<size_t>(m_NumFrames) * m_NumSlots * 12);
+    }
+
+    /* bytes of the table BakedAnimation(animation, samplesPerSecond) would allocate */
+    static size_t EstimateMemory(const Animation& animation, float samplesPerSecond)
+    {
+        return static_cast<size_t>(CountFrames(animation, samplesPerSecond)) * CountSlots(animation) * 12 * sizeof(float);
+    }
+
+    inline const Animation* GetAnimation() const { return m_Animation; }
+    inline int GetNumFrames() const { return m_NumFrames; }
+    inline int GetNumSlots() const { return m_NumSlots; }
+    inline size_t GetMemory() const { return m_Table.size() * sizeof(float); }
+    /* 3x4 row major matrices of every palette slot of frame */
+    inline const float* GetFrame(int frame) const { return &m_Table[static_cast<size_t>(frame) * m_NumSlots * 12]; }
+
+    /* time of frame in ticks */
+    inline float GetFrameTime(int frame) const { return m_FramesPerTick > 0.0f ? frame / m_FramesPerTick : 0.0f; }
+
+    /* stores the first GetNumSlots() entries of palette as frame */
+    void SetFrame(int frame, const std::vector<glm::mat4>& palette)
+    {
+        float* rows = &m_Table[static_cast<size_t>(frame) * m_NumSlots * 12];
+        for (int slot = 0; slot < m_NumSlots; slot++, rows += 12)
+            for (int row = 0; row < 3; row++)
+                for (int column = 0; column < 4; column++)
+                    rows[row * 4 + column] = palette[slot][column][row];
+    }
+
+    /* writes the palette at time (in ticks) into the first GetNumSlots() entries of palette,
+       either the nearest frame or a lerp of the two frames around time */
+    void Sample(float time, bool interpolate, std::vector<glm::mat4>& palette) const
+    {
+        float position = std::min(std::max(time * m_FramesPerTick, 0.0f), static_cast<float>(m_NumFrames - 1));
+        if (!interpolate)
+        {
+            int frame = static_cast<int>(position + 0.5f);
+            const float* rows = GetFrame(frame);
+            for (int slot = 0; slot < m_NumSlots; slot++, rows += 12)
+                palette[slot] = ToMatrix(rows);
+            return;
+        }
+
+        int frame = std::min(static_cast<int>(position), m_NumFrames - 2);
+        float weight = position - frame;
+        const float* rows = GetFrame(frame);
+        const float* nextRows = GetFrame(frame + 1);
+        float lerped[12];
+        for (int slot = 0; slot < m_NumSlots; slot++, rows += 12, nextRows += 12)
+        {
+            for (int i = 0; i < 12; i++)
+                lerped[i] = rows[i] + (nextRows[i] - rows[i]) * weight;
+            palette[slot] = ToMatrix(lerped);
+        }
+    }
+
+private:
+    const Animation* m_Animation;
+    int m_NumSlots;
+    int m_NumFrames;
+    float m_FramesPerTick;
+    std::vector<float> m_Table;  // frame major, then slot, 12 floats per matrix
+
+    /* palette entries the animation writes */
+    static int CountSlots(const Animation& animation)
+    {
+        const int* nodeSlots = animation.GetNodeSlots();
+        int numSlots = 0;
+        for (int node = 0; node < animation.GetSkeleton().GetNumNodes(); node++)
+            numSlots = std::max(numSlots, nodeSlots[node] + 1);
+        return numSlots;
+    }
+
+    static int CountFrames(const Animation& animation, float samplesPerSecond)
+    {
+        // assimp leaves the tick rate at 0 when the file does not say, and plays such clips at 25
+        float ticksPerSecond = animation.GetTicksPerSecond() > 0 ? animation.GetTicksPerSecond() : 25.0f;
+        float seconds = animation.GetDuration() / ticksPerSecond;
+        return std::max(1, static_cast<int>(std::ceil(seconds * samplesPerSecond))) + 1;
+    }
+
+    static glm::mat4 ToMatrix(const float* rows)
+    {
+        return glm::mat4(rows[0], rows[4], rows[8], 0.0f,
+                         rows[1], rows[5], rows[9], 0.0f,
+                         rows[2], rows[6], rows[10], 0.0f,
+                         rows[3], rows[7], rows[11], 1.0f);
+    }
+};
+
+#endif /* baked_animation_h */
@@ -0,0 +1,205 @@
+//
+//  batch_sampler.h
+//  skeletal_animation
+//
+
+#ifndef batch_sampler_h
+#define batch_sampler_h
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "animation_clip.h"
+#include "bone.h"
+#include "pose.h"
+#include "playback_state.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define SKELETAL_ANIMATION_SSE 1
+#endif
+
+/* four floats, one per bone of a lane group */
+struct Float4
+{
+#ifdef SKELETAL_ANIMATION_SSE
+    __m128 v;
+
+    static Float4 Load(const float* p) { Float4 r; r.v = _mm_load_ps(p); return r; }
+    static Float4 LoadUnaligned(const float* p) { Float4 r; r.v = _mm_loadu_ps(p); return r; }
+    static Float4 Broadcast(float f) { Float4 r; r.v = _mm_set1_ps(f); return r; }
+    void Store(float* p) const { _mm_store_ps(p, v); }
+    void StoreUnaligned(float* p) const { _mm_storeu_ps(p, v); }
+    friend Float4 operator+(Float4 a, Float4 b) { Float4 r; r.v = _mm_add_ps(a.v, b.v); return r; }
+    friend Float4 operator-(Float4 a, Float4 b) { Float4 r; r.v = _mm_sub_ps(a.v, b.v); return r; }
+    friend Float4 operator*(Float4 a, Float4 b) { Float4 r; r.v = _mm_mul_ps(a.v, b.v); return r; }
+    friend Float4 operator/(Float4 a, Float4 b) { Float4 r; r.v = _mm_div_ps(a.v, b.v); return r; }
+    friend Float4 Sqrt(Float4 a) { Float4 r; r.v = _mm_sqrt_ps(a.v); return r; }
+#else
+    float v[4];
+
+    static Float4 Load(const float* p) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+    static Float4 LoadUnaligned(const float* p) { return Load(p); }
+    static Float4 Broadcast(float f) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = f; return r; }
+    void Store(float* p) const { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+    void StoreUnaligned(float* p) const { Store(p); }
+    friend Float4 operator+(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    friend Float4 operator-(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    friend Float4 operator*(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    friend Float4 operator/(Float4 a, Float4 b) { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+    friend Float4 Sqrt(Float4 a) { for (int i = 0; i < 4; ++i) a.v[i] = std::sqrt(a.v[i]); return a; }
+#endif
+};
+
+/* samples every animated channel of an AnimationClip in one pass, four bones per lane group. keys are
+   located per bone (cursor or direct index), the interpolation itself runs on all four lanes
+   at once. constant channels keep the static pose the PlaybackState was bound with. rotations use
+   nlerp, which only matches slerp because AnimationClip stores consecutive rotation keys in the
+   same hemisphere. the clip is only read, all state lives in the PlaybackState. */
+class BatchSampler
+{
+public:
+    /* no element of a local transform differs from Bone::Sample by more than Epsilon. nlerp
+       drifts from slerp with the cube of the angle between the keys and stays within Epsilon
+       up to MaxNlerpAngle, baked clips stay far below it. keys farther apart, as left by
+       resampling at a low rate or by key reduction, are slerped lane by lane. */
+    static constexpr float Epsilon = 1e-3f;
+    static constexpr float MaxNlerpAngle = 0.3490659f;  // 20 degrees
+
+    /* samples into state, which has to be bound to a rest pose of the clip (PlaybackState::Bind) */
+    static void Sample(const AnimationClip& clip, float animationTime, PlaybackState& state)
+    {
+        SampleVectors(clip, PositionChannel, &TrackRange::position, clip.GetPositions(), &KeyframeCursor::position,
+                      animationTime, &BoneTransform::translation, state);
+        SampleRotations(clip, animationTime, state);
+        SampleVectors(clip, ScaleChannel, &TrackRange::scale, clip.GetScales(), &KeyframeCursor::scale,
+                      animationTime, &BoneTransform::scale, state);
+    }
+
+    /* largest difference of a local transform element between this sampler and Bone::Sample */
+    static float Validate(const AnimationClip& clip, float animationTime)
+    {
+        PlaybackState state;
+        state.Bind(&clip, clip.GetStaticPose(), clip.GetNumTracks());
+        Sample(clip, animationTime, state);
+        float maxError = 0.0f;
+        for (int track = 0; track < clip.GetNumTracks(); ++track)
+        {
+            Bone bone(&clip, track, track);
+            KeyframeCursor cursor;
+            BoneTransform pose = bone.GetRestPose();
+            bone.Sample(animationTime, cursor, pose);
+            glm::mat4 expected = pose.ToMatrix();
+            glm::mat4 actual = state.localPose[track].ToMatrix();
+            for (int column = 0; column < 4; ++column)
+                for (int row = 0; row < 4; ++row)
+                    maxError = std::max(maxError, std::abs(expected[column][row] - actual[column][row]));
+        }
+        return maxError;
+    }
+
+private:
+    /* finds the two keys around animationTime and the interpolation factor between them,
+       only called for animated channels so there are always at least two keys */
+    static int LocateKeys(const AnimationClip& clip, const ChannelRange& channel, float animationTime, int& cursor, float& factor)
+    {
+        const float* times = clip.GetTimes() + channel.timeOffset;
+        int index;
+        float invSampleInterval = clip.GetInvSampleInterval();
+        if (invSampleInterval > 0.0f)
+            index = std::min(std::max(static_cast<int>(animationTime * invSampleInterval), 0), channel.numKeys - 2);
+        else
+            index = FindKeyIndex(times, channel.numKeys, animationTime, cursor);
+        factor = (animationTime - times[index]) / (times[index + 1] - times[index]);
+        return index;
+    }
+
+    static void SampleVectors(const AnimationClip& clip, ChannelType type, ChannelRange TrackRange::* channelOf, const glm::vec3* values,
+                              int KeyframeCursor::* cursorOf, float animationTime, glm::vec3 BoneTransform::* out, PlaybackState& state)
+    {
+        const int* tracks = clip.GetAnimatedTracks(type);
+        int numAnimated = clip.GetNumAnimatedTracks(type);
+        for (int first = 0; first < numAnimated; first += 4)
+            SampleVectorLanes(clip, channelOf, values, cursorOf, tracks + first, std::min(4, numAnimated - first), animationTime, out, state);
+    }
+
+    static void SampleVectorLanes(const AnimationClip& clip, ChannelRange TrackRange::* channelOf, const glm::vec3* values,
+                                  int KeyframeCursor::* cursorOf, const int* tracks, int numLanes, float animationTime,
+                                  glm::vec3 BoneTransform::* out, PlaybackState& state)
+    {
+        alignas(16) float x0[4] = {}, y0[4] = {}, z0[4] = {};
+        alignas(16) float x1[4] = {}, y1[4] = {}, z1[4] = {};
+        alignas(16) float factors[4] = {};
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const ChannelRange& channel = clip.GetTrack(tracks[lane]).*channelOf;
+            int index = LocateKeys(clip, channel, animationTime, state.cursors[tracks[lane]].*cursorOf, factors[lane]);
+            const glm::vec3& a = values[channel.keyOffset + index];
+            const glm::vec3& b = values[channel.keyOffset + index + 1];
+            x0[lane] = a.x; y0[lane] = a.y; z0[lane] = a.z;
+            x1[lane] = b.x; y1[lane] = b.y; z1[lane] = b.z;
+        }
+
+        Float4 factor = Float4::Load(factors);
+        Float4 x = Float4::Load(x0), y = Float4::Load(y0), z = Float4::Load(z0);
+        x = x + (Float4::Load(x1) - x) * factor;
+        y = y + (Float4::Load(y1) - y) * factor;
+        z = z + (Float4::Load(z1) - z) * factor;
+        x.Store(x0); y.Store(y0); z.Store(z0);
+
+        for (int lane = 0; lane < numLanes; ++lane)
+            state.localPose[tracks[lane]].*out = glm::vec3(x0[lane], y0[lane], z0[lane]);
+    }
+
+    static void SampleRotations(const AnimationClip& clip, float animationTime, PlaybackState& state)
+    {
+        const int* tracks = clip.GetAnimatedTracks(RotationChannel);
+        int numAnimated = clip.GetNumAnimatedTracks(RotationChannel);
+        for (int first = 0; first < numAnimated; first += 4)
+            SampleRotationLanes(clip, tracks + first, std::min(4, numAnimated - first), animationTime, state);
+    }
+
+    static void SampleRotationLanes(const AnimationClip& clip, const int* tracks, int numLanes, float animationTime, PlaybackState& state)
+    {
+        alignas(16) float x0[4] = {}, y0[4] = {}, z0[4] = {}, w0[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        alignas(16) float x1[4] = {}, y1[4] = {}, z1[4] = {}, w1[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        alignas(16) float factors[4] = {};
+        const glm::quat* values = clip.GetRotations();
+        // the dot product of keys at most MaxNlerpAngle apart, cos of half the angle
+        const float minNlerpDot = 0.9848078f;
+        const glm::quat* wideKeys[4] = {};
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const ChannelRange& channel = clip.GetTrack(tracks[lane]).rotation;
+            int index = LocateKeys(clip, channel, animationTime, state.cursors[tracks[lane]].rotation, factors[lane]);
+            const glm::quat& a = values[channel.keyOffset + index];
+            const glm::quat& b = values[channel.keyOffset + index + 1];
+            x0[lane] = a.x; y0[lane] = a.y; z0[lane] = a.z; w0[lane] = a.w;
+            x1[lane] = b.x; y1[lane] = b.y; z1[lane] = b.z; w1[lane] = b.w;
+            if (glm::dot(a, b) < minNlerpDot)
+                wideKeys[lane] = &a;
+        }
+
+        // nlerp: keys already share a hemisphere, so a plain lerp and renormalize
+        Float4 factor = Float4::Load(factors);
+        Float4 x = Float4::Load(x0), y = Float4::Load(y0), z = Float4::Load(z0), w = Float4::Load(w0);
+        x = x + (Float4::Load(x1) - x) * factor;
+        y = y + (Float4::Load(y1) - y) * factor;
+        z = z + (Float4::Load(z1) - z) * factor;
+        w = w + (Float4::Load(w1) - w) * factor;
+        Float4 length = Sqrt(x * x + y * y + z * z + w * w);
+        x = x / length; y = y / length; z = z / length; w = w / length;
+        x.Store(x0); y.Store(y0); z.Store(z0); w.Store(w0);
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            if (wideKeys[lane])
+                state.localPose[tracks[lane]].rotation = InterpolateKeyValue(wideKeys[lane][0], wideKeys[lane][1], factors[lane]);
+            else
+                state.localPose[tracks[lane]].rotation = glm::quat(w0[lane], x0[lane], y0[lane], z0[lane]);
+        }
+    }
+};
+
+#endif /* batch_sampler_h */
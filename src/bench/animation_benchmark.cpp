@@ -0,0 +1,583 @@
+//
+//  animation_benchmark.cpp
+//  skeletal_animation
+//
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <animation_scheduler.h>
+#include <animation_system.h>
+#include <model_animation.h>
+#include <cooked_asset_writer.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// read by Animator
+bool isPlayingAnimation = true;
+bool isPlayingSingleBone = false;
+
+// counts every heap allocation, to check that blending does not allocate per frame
+static std::atomic<long> g_NumAllocations(0);
+
+void* operator new(std::size_t size)
+{
+    g_NumAllocations++;
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+// checks of the numbers the optimizations promise, the benchmark exits non-zero when one fails
+static int g_NumFailedChecks = 0;
+
+/* prints value against its bound and counts the check as failed when value exceeds it */
+void CheckAtMost(const char* what, double value, double bound)
+{
+    bool passed = value <= bound;
+    std::cout << what << "  " << value << " <= " << bound << "  " << (passed ? "ok" : "FAILED") << std::endl;
+    if (!passed)
+        g_NumFailedChecks++;
+}
+
+/* the batch sampler against Bone::Sample at times spread over the whole clip */
+void CheckBatchSampler(const Animation& animation)
+{
+    const AnimationClip& clip = animation.GetClip();
+    if (clip.GetNumTracks() == 0)
+        return;
+    const int numTimes = 512;
+    float maxError = 0.0f;
+    for (int i = 0; i <= numTimes; i++)
+        maxError = std::max(maxError, BatchSampler::Validate(clip, animation.GetDuration() * i / numTimes));
+    CheckAtMost("batch sampler max error", maxError, BatchSampler::Epsilon);
+}
+
+/* largest distance between the translations of the first numSlots matrices of a and b */
+float MaxTranslationDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b, int numSlots)
+{
+    float maxDifference = 0.0f;
+    for (int slot = 0; slot < numSlots; slot++)
+        maxDifference = std::max(maxDifference, glm::length(glm::vec3(a[slot][3] - b[slot][3])));
+    return maxDifference;
+}
+
+/* largest distance of a joint from the origin over the whole clip, the scale the errors below are relative to */
+float MeasurePoseExtent(const Animation& animation)
+{
+    Animator animator(&animation);
+    animator.setPlayMode(true, false);
+    float extent = 0.0f;
+    for (int i = 0; i < 64; i++)
+    {
+        animator.setCurrentTime(animation.GetDuration() * i / 64);
+        animator.EvaluatePose();
+        for (const glm::mat4& matrix : animator.GetFinalBoneMatrices())
+            extent = std::max(extent, glm::length(glm::vec3(matrix[3])));
+    }
+    return std::max(extent, 1e-3f);
+}
+
+/* fastest change between two keys of channel, per tick */
+template <typename T>
+float MaxKeySpeed(const AnimationClip& clip, const ChannelRange& channel, const T* values)
+{
+    const float* times = clip.GetTimes() + channel.timeOffset;
+    const T* keys = values + channel.keyOffset;
+    float maxSpeed = 0.0f;
+    for (int key = 1; key < channel.numKeys; key++)
+    {
+        if (times[key] > times[key - 1])
+            maxSpeed = std::max(maxSpeed, KeyValueDistance(keys[key - 1], keys[key]) / (times[key] - times[key - 1]));
+    }
+    return maxSpeed;
+}
+
+/* keys of the compressed clip against the float keys they were packed from, as a fraction of
+   what the format allows. a vector is off by half a 16 bit step of its range per axis. smallest
+   three is off by half a 15 bit step of sqrt(2) in each stored component, the rebuilt one is at
+   least 1/2, which bounds the rotation at 1.5e-4 radians. keys whose times do not land on a
+   frame move by up to half a frame step, which adds the fastest change of the channel over it. */
+void CheckCompression(const Animation& animation)
+{
+    const AnimationClip& clip = animation.GetClip();
+    if (clip.GetNumTracks() == 0)
+        return;
+    CompressedAnimationClip compressed(clip);
+    CheckAtMost("compression rejected the clip", compressed.GetNumTracks() == 0 ? 1.0 : 0.0, 0.0);
+    float snap = 0.5f * compressed.GetFrameStep();
+    float maxPosition = 0.0f, maxRotation = 0.0f, maxScale = 0.0f;
+    for (int track = 0; track < compressed.GetNumTracks(); track++)
+    {
+        const TrackRange& source = clip.GetTrack(track);
+        const CompressedTrack& range = compressed.GetTrack(track);
+        const TrackError& error = compressed.GetError(track);
+        // a little slack for the float arithmetic of encoding and decoding
+        float positionBound = glm::length(range.position.rangeExtent) * (0.5f / 65535.0f) * 1.01f + 1e-6f
+                            + snap * MaxKeySpeed(clip, source.position, clip.GetPositions());
+        float rotationBound = 1.5e-4f + snap * MaxKeySpeed(clip, source.rotation, clip.GetRotations());
+        float scaleBound = glm::length(range.scale.rangeExtent) * (0.5f / 65535.0f) * 1.01f + 1e-6f
+                         + snap * MaxKeySpeed(clip, source.scale, clip.GetScales());
+        maxPosition = std::max(maxPosition, error.position / positionBound);
+        maxRotation = std::max(maxRotation, error.rotation / rotationBound);
+        maxScale = std::max(maxScale, error.scale / scaleBound);
+    }
+    CheckAtMost("compressed position error / bound", maxPosition, 1.0);
+    CheckAtMost("compressed rotation error / bound", maxRotation, 1.0);
+    CheckAtMost("compressed scale error / bound", maxScale, 1.0);
+}
+
+/* joints of the clip reduced at a tolerance of 0.1% of the pose extent against the source keys,
+   in model space. joints are the palette matrices with their bone offsets taken out again. */
+void CheckReduction(const ImportSession& session, Model& model, const Animation& animation, float extent)
+{
+    AnimationImportSettings settings;
+    settings.reducePositionTolerance = 1e-3f * extent;
+    Animation reduced(session, &model, settings);
+    Animator source(&animation), target(&reduced);
+    source.setPlayMode(true, false);
+    target.setPlayMode(true, false);
+
+    float maxError = 0.0f;
+    const int numTimes = 256;
+    for (int i = 0; i <= numTimes; i++)
+    {
+        float time = animation.GetDuration() * i / numTimes;
+        source.setCurrentTime(time);
+        target.setCurrentTime(time);
+        source.EvaluatePose();
+        target.EvaluatePose();
+        for (const auto& bone : model.GetBoneInfoMap())
+        {
+            int id = bone.second.id;
+            if (id < 0 || id >= static_cast<int>(source.GetFinalBoneMatrices().size()))
+                continue;
+            glm::mat4 bindToBone = glm::inverse(bone.second.offset);
+            glm::vec3 sourceJoint(source.GetFinalBoneMatrices()[id] * bindToBone[3]);
+            glm::vec3 targetJoint(target.GetFinalBoneMatrices()[id] * bindToBone[3]);
+            maxError = std::max(maxError, glm::length(sourceJoint - targetJoint));
+        }
+    }
+    CheckAtMost("reduced joint error / tolerance", maxError / settings.reducePositionTolerance, 1.0);
+}
+
+/* a baked clip reproduces the live pose on its frames and lerping between frames is no worse
+   than snapping to the nearest one */
+void CheckBake(const Animation& animation, float extent)
+{
+    BakedAnimation baked(animation, 30.0f);
+    BakeAnimation(baked);
+    CheckAtMost("baked memory - estimate", std::fabs(static_cast<double>(baked.GetMemory()) -
+                static_cast<double>(BakedAnimation::EstimateMemory(animation, 30.0f))), 0.0);
+
+    Animator animator(&animation);
+    animator.setPlayMode(true, false);
+    std::vector<glm::mat4> palette(animator.GetFinalBoneMatrices());
+    float maxError = 0.0f;
+    for (int frame = 0; frame < baked.GetNumFrames(); frame++)
+    {
+        animator.setCurrentTime(baked.GetFrameTime(frame));
+        animator.EvaluatePose();
+        baked.Sample(baked.GetFrameTime(frame), true, palette);
+        maxError = std::max(maxError, MaxTranslationDifference(palette, animator.GetFinalBoneMatrices(), baked.GetNumSlots()));
+    }
+    CheckAtMost("baked frame error / extent", maxError / extent, 1e-5);
+
+    BakedAnimationError nearest = MeasureBakeError(baked, false);
+    BakedAnimationError lerped = MeasureBakeError(baked, true);
+    CheckAtMost("baked lerp error - nearest error", lerped.maxTranslation - nearest.maxTranslation, 0.0);
+}
+
+/* an n-way blend of copies of the clip at the same phase, fading from the clip itself, is the
+   pose of the clip alone up to the rounding of the weighted sums */
+void CheckBlend(const Animation& animation, float extent)
+{
+    Animator plain(&animation), blended(&animation);
+    plain.setPlayMode(true, false);
+    blended.setPlayMode(true, false);
+    blended.CrossFade(&animation, 1.0f);
+    for (int clip = 1; clip < 4; clip++)
+        blended.AddBlendClip(&animation, 1.0f / (clip + 1));
+
+    float maxError = 0.0f;
+    const float dt = 1.0f / 60.0f;
+    for (int frame = 0; frame < 120; frame++)
+    {
+        plain.UpdateAnimation(dt);
+        blended.UpdateAnimation(dt);
+        maxError = std::max(maxError, MaxTranslationDifference(plain.GetFinalBoneMatrices(), blended.GetFinalBoneMatrices(),
+                                                               static_cast<int>(plain.GetFinalBoneMatrices().size())));
+    }
+    CheckAtMost("blend of one clip error / extent", maxError / extent, 1e-4);
+}
+
+/* updates characters animators sharing one clip for frames frames, returns milliseconds per frame */
+double RunBenchmark(const Animation& animation, int numThreads, int characters, int frames,
+                    std::vector<glm::mat4>& palettes)
+{
+    JobSystem jobs(numThreads);
+    AnimationSystem system(&jobs);
+    for (int i = 0; i < characters; i++)
+    {
+        int index = system.AddAnimator(&animation);
+        // spread the instances over the clip so they do not all sample the same keys
+        system.GetAnimator(index).setCurrentTime(animation.GetDuration() * i / characters);
+    }
+
+    const float dt = 1.0f / 60.0f;
+    for (int frame = 0; frame < 10; frame++)
+        system.Update(dt);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+        system.Update(dt);
+    auto end = std::chrono::steady_clock::now();
+
+    palettes.clear();
+    for (int i = 0; i < characters; i++)
+    {
+        const std::vector<glm::mat4>& matrices = system.GetAnimator(i).GetFinalBoneMatrices();
+        palettes.insert(palettes.end(), matrices.begin(), matrices.end());
+    }
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+/* crowd of rows of 16 characters receding from the camera, returns evaluated poses per frame with LOD */
+double RunLODBenchmark(const Animation& animation, int characters, int frames)
+{
+    const int rowLength = 16;
+    const float spacing = 2.0f;
+    Camera camera(glm::vec3(0.0f, 1.0f, 3.0f));
+    AnimationSystem system;
+    for (int i = 0; i < characters; i++)
+    {
+        int index = system.AddAnimator(&animation);
+        glm::vec3 center((i % rowLength - rowLength / 2) * spacing, 0.0f, -(i / rowLength) * spacing);
+        system.SetBounds(index, center, 1.0f);
+    }
+
+    long evaluated = 0;
+    const float dt = 1.0f / 60.0f;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        system.Update(dt, &camera);
+        evaluated += system.GetNumEvaluated();
+    }
+    return static_cast<double>(evaluated) / frames;
+}
+
+/* crowd playing one clip at 8 phase offsets with small jitter, prints ms per frame and hit rate per time step */
+void RunPoseCacheBenchmark(const Animation& animation, int characters, int frames)
+{
+    std::cout << "pose cache, 8 phases with jitter" << std::endl;
+    std::cout << "time step  ms/frame  hit rate" << std::endl;
+    const float timeSteps[] = { -1.0f, 0.0f, 0.5f, 1.0f };
+    for (float timeStep : timeSteps)
+    {
+        JobSystem jobs;
+        AnimationSystem system(&jobs);
+        PoseCache cache(std::max(timeStep, 0.0f));
+        if (timeStep >= 0.0f)
+            system.SetPoseCache(&cache);
+        for (int i = 0; i < characters; i++)
+        {
+            int index = system.AddAnimator(&animation);
+            float phase = animation.GetDuration() * (i % 8) / 8.0f;
+            system.GetAnimator(index).setCurrentTime(phase + 0.1f * (i % 3));
+        }
+
+        const float dt = 1.0f / 60.0f;
+        double hitRate = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            system.Update(dt);
+            hitRate += static_cast<double>(cache.GetHitRate());
+        }
+        auto end = std::chrono::steady_clock::now();
+        std::cout << (timeStep < 0.0f ? std::string("no cache") : std::to_string(timeStep)) << "  "
+                  << std::chrono::duration<double, std::milli>(end - start).count() / frames << "  "
+                  << hitRate / frames << std::endl;
+    }
+}
+
+/* crowd playing clips baked at several rates against live sampling, prints memory, error and ms per frame */
+void RunBakedBenchmark(const Animation& animation, int characters, int frames)
+{
+    std::cout << "baked palettes" << std::endl;
+    std::cout << "samples/s  KiB  lerp  max error  mean error  ms/frame" << std::endl;
+    const int rates[] = { 0, 15, 30, 60 };
+    for (int rate : rates)
+    {
+        // rate 0 is the live reference
+        bool live = rate == 0;
+        BakedAnimation baked(animation, static_cast<float>(std::max(rate, 1)));
+        if (!live)
+            BakeAnimation(baked);
+        for (int lerp = 0; lerp < 2; lerp++)
+        {
+            if (live && lerp == 1)
+                continue;
+            AnimationSystem system;
+            for (int i = 0; i < characters; i++)
+            {
+                int index = system.AddAnimator(&animation);
+                system.GetAnimator(index).setCurrentTime(animation.GetDuration() * i / characters);
+                if (!live)
+                    system.GetAnimator(index).setBakedAnimation(&baked, lerp == 1);
+            }
+
+            const float dt = 1.0f / 60.0f;
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+                system.Update(dt);
+            auto end = std::chrono::steady_clock::now();
+            double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+
+            if (live)
+            {
+                std::cout << "live  0  -  0  0  " << milliseconds << std::endl;
+                continue;
+            }
+            BakedAnimationError error = MeasureBakeError(baked, lerp == 1);
+            std::cout << rate << "  " << baked.GetMemory() / 1024 << "  " << (lerp ? "yes" : "no") << "  "
+                      << error.maxTranslation << "  " << error.meanTranslation << "  " << milliseconds << std::endl;
+        }
+    }
+}
+
+/* every character blends clips copies of the clip at different weights while cross-fading, prints
+   ms per frame and heap allocations per frame once the scratch poses are warm */
+void RunBlendBenchmark(const Animation& animation, int characters, int frames)
+{
+    std::cout << "blending, cross-fade into an n-way blend" << std::endl;
+    std::cout << "clips  ms/frame  allocations/frame" << std::endl;
+    const int clipCounts[] = { 2, 4, 8 };
+    for (int clips : clipCounts)
+    {
+        JobSystem jobs;
+        AnimationSystem system(&jobs);
+        for (int i = 0; i < characters; i++)
+        {
+            int index = system.AddAnimator(&animation);
+            Animator& animator = system.GetAnimator(index);
+            animator.setCurrentTime(animation.GetDuration() * i / characters);
+            // fading lasts the whole run, the previous pose blends in on top of the n-way blend
+            animator.CrossFade(&animation, 2.0f * frames / 60.0f);
+            for (int clip = 1; clip < clips; clip++)
+                animator.AddBlendClip(&animation, 1.0f / (clip + 1));
+        }
+
+        const float dt = 1.0f / 60.0f;
+        for (int frame = 0; frame < 10; frame++)
+            system.Update(dt);
+
+        long allocations = g_NumAllocations;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            system.Update(dt);
+        auto end = std::chrono::steady_clock::now();
+        allocations = g_NumAllocations - allocations;
+        std::cout << clips << "  " << std::chrono::duration<double, std::milli>(end - start).count() / frames << "  "
+                  << static_cast<double>(allocations) / frames << std::endl;
+    }
+}
+
+/* runs a budgeted crowd that grows from characters to 4 * characters halfway through */
+void RunSchedulerBenchmark(const Animation& animation, int characters, int frames, float budget)
+{
+    const int rowLength = 16;
+    const float spacing = 2.0f;
+    Camera camera(glm::vec3(0.0f, 1.0f, 3.0f));
+    JobSystem jobs;
+    AnimationSystem system(&jobs);
+    AnimationScheduler scheduler(&system, budget);
+
+    std::cout << "scheduler, budget " << budget << " ms" << std::endl;
+    std::cout << "characters  avg ms  max ms  updated  skipped  max staleness" << std::endl;
+    const float dt = 1.0f / 60.0f;
+    for (int phase = 0; phase < 2; phase++)
+    {
+        int crowd = phase == 0 ? characters : 4 * characters;
+        for (int i = system.GetNumAnimators(); i < crowd; i++)
+        {
+            int index = system.AddAnimator(&animation);
+            glm::vec3 center((i % rowLength - rowLength / 2) * spacing, 0.0f, -(i / rowLength) * spacing);
+            system.SetBounds(index, center, 1.0f);
+        }
+
+        double total = 0.0, worst = 0.0;
+        long updated = 0, skipped = 0;
+        int maxStaleness = 0;
+        for (int frame = 0; frame < frames / 2; frame++)
+        {
+            scheduler.Update(dt, camera);
+            const AnimationSchedulerStats& stats = scheduler.GetStats();
+            total += static_cast<double>(stats.milliseconds);
+            worst = std::max(worst, static_cast<double>(stats.milliseconds));
+            updated += stats.updated;
+            skipped += stats.skipped;
+            maxStaleness = std::max(maxStaleness, stats.maxStaleness);
+        }
+        int numFrames = std::max(frames / 2, 1);
+        std::cout << crowd << "  " << total / numFrames << "  " << worst << "  " << updated / numFrames << "  "
+                  << skipped / numFrames << "  " << maxStaleness << std::endl;
+    }
+}
+
+/* imports modelPath with every import profile and prints what each one costs and produces */
+void RunImportProfileBenchmark(const char* modelPath)
+{
+    std::cout << "profile  ms  vertices  indices  bones" << std::endl;
+    const ImportProfile* profiles[] = { &ImportProfile::RuntimeMinimal(), &ImportProfile::AnimationOnly(), &ImportProfile::FullQuality() };
+    for (const ImportProfile* profile : profiles)
+    {
+        ImportSession session(modelPath, *profile);
+        const ImportStats& stats = session.GetStats();
+        std::cout << profile->name << "  " << stats.milliseconds << "  " << stats.numVertices << "  "
+                  << stats.numIndices << "  " << stats.numBones << std::endl;
+    }
+}
+
+/* loads modelPath with a parse for the Model and one for the Animation, then with one shared
+   ImportSession, then from a cooked copy written next to it, and prints the milliseconds of each */
+void RunImportBenchmark(const char* modelPath)
+{
+    typedef std::chrono::steady_clock Clock;
+    std::cout << "import  ms" << std::endl;
+    Clock::time_point start = Clock::now();
+    {
+        Model model(modelPath);
+        Animation animation(modelPath, &model);
+    }
+    double separate = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::string cookedPath = std::string(modelPath) + ".skc";
+    bool cooked;
+    start = Clock::now();
+    {
+        ImportSession session(modelPath);
+        Model model(session);
+        Animation animation(session, &model);
+        std::cout << "separate  " << separate << std::endl;
+        std::cout << "shared  " << std::chrono::duration<double, std::milli>(Clock::now() - start).count() << std::endl;
+        cooked = WriteCookedAsset(cookedPath, model, std::vector<const Animation*>(1, &animation));
+    }
+    if (!cooked)
+        return;
+
+    start = Clock::now();
+    {
+        CookedAsset asset(cookedPath);
+        Model model(asset);
+        Animation animation(asset, &model);
+        std::cout << "cooked  " << std::chrono::duration<double, std::milli>(Clock::now() - start).count()
+                  << "  (" << asset.GetSize() << " bytes)" << std::endl;
+    }
+    std::remove(cookedPath.c_str());
+}
+
+int main(int argc, const char * argv[]) {
+    if (argc < 2)
+    {
+        std::cout << "$./build/bin/animation_benchmark [model path] [characters] [frames]" << std::endl;
+        std::cout << "e.g. $./bin/animation_benchmark ../resources/Wolf_dae.dae 512 200" << std::endl;
+        return -1;
+    }
+    const char* modelPath = argv[1];
+    int characters = argc > 2 ? std::atoi(argv[2]) : 512;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 200;
+
+    // Model uploads meshes and textures, so it needs a context even though nothing is drawn
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "animation_benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    RunImportProfileBenchmark(modelPath);
+
+    RunImportBenchmark(modelPath);
+
+    ImportSession session(modelPath);
+    Model model(session);
+    Animation animation(session, &model);
+
+    std::cout << "checks" << std::endl;
+    float extent = MeasurePoseExtent(animation);
+    CheckBatchSampler(animation);
+    CheckCompression(animation);
+    CheckReduction(session, model, animation, extent);
+    CheckBake(animation, extent);
+    CheckBlend(animation, extent);
+
+    int maxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    std::cout << characters << " characters, " << frames << " frames" << std::endl;
+    std::cout << "threads  ms/frame  speedup  identical" << std::endl;
+    std::vector<glm::mat4> reference, palettes;
+    double serial = RunBenchmark(animation, 1, characters, frames, reference);
+    for (int threads : threadCounts)
+    {
+        double milliseconds = threads == 1 ? serial : RunBenchmark(animation, threads, characters, frames, palettes);
+        bool identical = threads == 1 ||
+            (palettes.size() == reference.size() &&
+             std::memcmp(palettes.data(), reference.data(), reference.size() * sizeof(glm::mat4)) == 0);
+        std::cout << threads << "  " << milliseconds << "  " << serial / milliseconds << "  "
+                  << (identical ? "yes" : "NO") << std::endl;
+    }
+
+    std::cout << "LOD, rows of 16 characters receding from the camera" << std::endl;
+    std::cout << "characters  evaluated/frame" << std::endl;
+    for (int crowd = 64; crowd <= characters; crowd *= 2)
+        std::cout << crowd << "  " << RunLODBenchmark(animation, crowd, frames) << std::endl;
+
+    RunSchedulerBenchmark(animation, characters, frames, 2.0f);
+
+    RunPoseCacheBenchmark(animation, characters, frames);
+
+    RunBakedBenchmark(animation, characters, frames);
+
+    RunBlendBenchmark(animation, characters, frames);
+
+    glfwTerminate();
+    if (g_NumFailedChecks > 0)
+    {
+        std::cout << g_NumFailedChecks << " checks FAILED" << std::endl;
+        return 1;
+    }
+    return 0;
+}
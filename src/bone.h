@@ -11,119 +11,88 @@
 #define bone_h
 
 #include <vector>
+#include <algorithm>
 #include <assimp/scene.h>
 #include <list>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/quaternion.hpp>
-#include "assimp_glm_helpers.h"
-
-struct KeyPosition {
-    glm::vec3 position;
-    float timeStamp;
-};
-
-struct KeyRotation {
-    glm::quat orientation;
-    float timeStamp;
-};
-
-struct KeyScale {
-    glm::vec3 scale;
-    float timeStamp;
-};
-
+#include "animation_clip.h"
+#include "clip_compression.h"
+#include "pose.h"
+#include "playback_state.h"
+
+/* one animated bone: a view onto its track inside the AnimationClip blob,
+   or inside the CompressedAnimationClip when the clip was imported compressed.
+   bones are read-only after load, the cursor and the sampled pose belong to the caller
+   (see PlaybackState). a track without any animated channel is static, its rest pose is
+   read once here and Sample leaves it alone. */
 class Bone
 {
 public:
-    Bone(const std::string& name, int ID, const aiNodeAnim* channel) : m_Name(name), m_ID(ID), m_LocalTransform(1.0f)
+    Bone(const AnimationClip* clip, int track, int ID) : m_Clip(clip), m_CompressedClip(nullptr), m_Track(track), m_ID(ID)
     {
-        m_NumPositions = channel->mNumPositionKeys;
-        
-        for (int positionIndex = 0; positionIndex < m_NumPositions; ++positionIndex)
-        {
-            aiVector3D aiPosition = channel->mPositionKeys[positionIndex].mValue;
-            float timeStamp = channel->mPositionKeys[positionIndex].mTime;
-            KeyPosition data;
-            data.position = AssimpGLMHelpers::GetGLMVec(aiPosition);
-            data.timeStamp = timeStamp;
-            m_Positions.push_back(data);
-        }
-        
-        m_NumRotations = channel->mNumRotationKeys;
-        for (int rotationIndex = 0; rotationIndex < m_NumRotations; ++rotationIndex)
-        {
-            aiQuaternion aiOrientation = channel->mRotationKeys[rotationIndex].mValue;
-            float timeStamp = channel->mRotationKeys[rotationIndex].mTime;
-            KeyRotation data;
-            data.orientation = AssimpGLMHelpers::GetGLMQuat(aiOrientation);
-            data.timeStamp = timeStamp;
-            m_Rotations.push_back(data);
-        }
-        
-        m_NumScalings = channel->mNumScalingKeys;
-        for (int keyIndex = 0; keyIndex < m_NumScalings; ++keyIndex)
-        {
-            aiVector3D scale = channel->mScalingKeys[keyIndex].mValue;
-            float timeStamp = channel->mScalingKeys[keyIndex].mTime;
-            KeyScale data;
-            data.scale = AssimpGLMHelpers::GetGLMVec(scale);
-            data.timeStamp = timeStamp;
-            m_Scales.push_back(data);
-        }
+        m_Static = clip->IsStaticTrack(track);
+        m_RestPose = clip->GetStaticPose()[track];
     }
-    void Update(float animationTime)
+    Bone(const CompressedAnimationClip* clip, int track, int ID) : m_Clip(nullptr), m_CompressedClip(clip), m_Track(track), m_ID(ID)
     {
-        glm::mat4 translation = InterpolatePosition(animationTime);
-        glm::mat4 rotation = InterpolateRotation(animationTime);
-        glm::mat4 scale = InterpolateScaling(animationTime);
-        m_LocalTransform = translation * rotation * scale;
+        m_Static = false;
+        KeyframeCursor cursor;
+        Sample(0.0f, cursor, m_RestPose);
+        m_Static = clip->IsStaticTrack(track);
     }
-    glm::mat4 GetLocalTransform() { return m_LocalTransform; }
-    std::string GetBoneName() const { return m_Name; }
-    int GetBoneID() { return m_ID; }
-    
-    int GetPositionIndex(float animationTime)
+
+    /* writes the local transform at animationTime into pose, which has to start out as GetRestPose() */
+    void Sample(float animationTime, KeyframeCursor& cursor, BoneTransform& pose) const
     {
-        for (int index = 0; index < m_NumPositions - 1; ++index)
-        {
-            if (animationTime < m_Positions[index + 1].timeStamp)
-                return index;
-        }
-        assert(0);
+        if (m_Static)
+            return;
+        pose.translation = InterpolatePosition(animationTime, cursor.position);
+        pose.rotation = InterpolateRotation(animationTime, cursor.rotation);
+        pose.scale = InterpolateScaling(animationTime, cursor.scale);
     }
+    const BoneTransform& GetRestPose() const { return m_RestPose; }
+    int GetBoneID() const { return m_ID; }
+    int GetTrack() const { return m_Track; }
+    bool IsStatic() const { return m_Static; }
+private:
+    const AnimationClip* m_Clip;
+    const CompressedAnimationClip* m_CompressedClip;
+    int m_Track;
+    int m_ID;
+    bool m_Static;
 
-    int GetRotationIndex(float animationTime)
+    BoneTransform m_RestPose;
+
+    int GetKeyIndex(const ChannelRange& channel, float animationTime, int& cursor) const
     {
-        for (int index = 0; index < m_NumRotations - 1; ++index)
+        // uniformly resampled clips compute the key directly
+        float invSampleInterval = m_Clip->GetInvSampleInterval();
+        if (invSampleInterval > 0.0f)
         {
-            if (animationTime < m_Rotations[index + 1].timeStamp)
-                return index;
+            int index = static_cast<int>(animationTime * invSampleInterval);
+            return std::min(std::max(index, 0), channel.numKeys - 2);
         }
-        assert(0);
+        return FindKeyIndex(m_Clip->GetTimes() + channel.timeOffset, channel.numKeys, animationTime, cursor);
     }
 
-    int GetScaleIndex(float animationTime)
+    // float keys only, compressed clips find their keys in CompressedAnimationClip
+    int GetPositionIndex(float animationTime, int& cursor) const
     {
-        for (int index = 0; index < m_NumScalings - 1; ++index)
-        {
-            if (animationTime < m_Scales[index + 1].timeStamp)
-                return index;
-        }
-        assert(0);
+        return GetKeyIndex(m_Clip->GetTrack(m_Track).position, animationTime, cursor);
     }
-private:
-    std::vector<KeyPosition> m_Positions;
-    std::vector<KeyRotation> m_Rotations;
-    std::vector<KeyScale> m_Scales;
-    int m_NumPositions;
-    int m_NumRotations;
-    int m_NumScalings;
-    
-    glm::mat4 m_LocalTransform;
-    std::string m_Name;
-    int m_ID;
-    
-    float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
+
+    int GetRotationIndex(float animationTime, int& cursor) const
+    {
+        return GetKeyIndex(m_Clip->GetTrack(m_Track).rotation, animationTime, cursor);
+    }
+
+    int GetScaleIndex(float animationTime, int& cursor) const
+    {
+        return GetKeyIndex(m_Clip->GetTrack(m_Track).scale, animationTime, cursor);
+    }
+
+    float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime) const
     {
         float scaleFactor = 0.0f;
         float midWayLength = animationTime - lastTimeStamp;
@@ -132,57 +101,59 @@ private:
         return scaleFactor;
     }
 
-    glm::mat4 InterpolatePosition(float animationTime)
+    glm::vec3 InterpolatePosition(float animationTime, int& cursor) const
     {
-        if (1 == m_NumPositions)
-            return glm::translate(glm::mat4(1.0f), m_Positions[0].position);
+        if (m_CompressedClip)
+            return m_CompressedClip->SamplePosition(m_Track, animationTime, cursor);
 
-        int p0Index = GetPositionIndex(animationTime);
+        const ChannelRange& channel = m_Clip->GetTrack(m_Track).position;
+        const float* times = m_Clip->GetTimes() + channel.timeOffset;
+        const glm::vec3* positions = m_Clip->GetPositions() + channel.keyOffset;
+        if (1 == channel.numKeys)
+            return positions[0];
+
+        int p0Index = GetPositionIndex(animationTime, cursor);
         int p1Index = p0Index + 1;
-        float scaleFactor = GetScaleFactor(m_Positions[p0Index].timeStamp,
-                                           m_Positions[p1Index].timeStamp,
-                                           animationTime);
-        glm::vec3 finalPosition = glm::mix(m_Positions[p0Index].position,
-                                           m_Positions[p1Index].position,
-                                           scaleFactor);
-        return glm::translate(glm::mat4(1.0f), finalPosition);
+        float scaleFactor = GetScaleFactor(times[p0Index], times[p1Index], animationTime);
+        glm::vec3 finalPosition = glm::mix(positions[p0Index], positions[p1Index], scaleFactor);
+        return finalPosition;
     }
 
-    glm::mat4 InterpolateRotation(float animationTime)
+    glm::quat InterpolateRotation(float animationTime, int& cursor) const
     {
-        if (1 == m_NumRotations)
-        {
-            auto rotation = glm::normalize(m_Rotations[0].orientation);
-            return glm::toMat4(rotation);
-        }
+        if (m_CompressedClip)
+            return m_CompressedClip->SampleRotation(m_Track, animationTime, cursor);
+
+        const ChannelRange& channel = m_Clip->GetTrack(m_Track).rotation;
+        const float* times = m_Clip->GetTimes() + channel.timeOffset;
+        const glm::quat* rotations = m_Clip->GetRotations() + channel.keyOffset;
+        if (1 == channel.numKeys)
+            return glm::normalize(rotations[0]);
 
-        int p0Index = GetRotationIndex(animationTime);
+        int p0Index = GetRotationIndex(animationTime, cursor);
         int p1Index = p0Index + 1;
-        float scaleFactor = GetScaleFactor(m_Rotations[p0Index].timeStamp,
-                                           m_Rotations[p1Index].timeStamp,
-                                           animationTime);
-        glm::quat finalRotation = glm::slerp(m_Rotations[p0Index].orientation,
-                                             m_Rotations[p1Index].orientation,
-                                             scaleFactor);
+        float scaleFactor = GetScaleFactor(times[p0Index], times[p1Index], animationTime);
+        glm::quat finalRotation = glm::slerp(rotations[p0Index], rotations[p1Index], scaleFactor);
         finalRotation = glm::normalize(finalRotation);
-        return glm::toMat4(finalRotation);
-
+        return finalRotation;
     }
 
-    glm::mat4 InterpolateScaling(float animationTime)
+    glm::vec3 InterpolateScaling(float animationTime, int& cursor) const
     {
-        if (1 == m_NumScalings)
-            return glm::scale(glm::mat4(1.0f), m_Scales[0].scale);
+        if (m_CompressedClip)
+            return m_CompressedClip->SampleScale(m_Track, animationTime, cursor);
+
+        const ChannelRange& channel = m_Clip->GetTrack(m_Track).scale;
+        const float* times = m_Clip->GetTimes() + channel.timeOffset;
+        const glm::vec3* scales = m_Clip->GetScales() + channel.keyOffset;
+        if (1 == channel.numKeys)
+            return scales[0];
 
-        int p0Index = GetScaleIndex(animationTime);
+        int p0Index = GetScaleIndex(animationTime, cursor);
         int p1Index = p0Index + 1;
-        float scaleFactor = GetScaleFactor(m_Scales[p0Index].timeStamp,
-                                           m_Scales[p1Index].timeStamp,
-                                           animationTime);
-        glm::vec3 finalScale = glm::mix(m_Scales[p0Index].scale,
-                                        m_Scales[p1Index].scale,
-                                        scaleFactor);
-        return glm::scale(glm::mat4(1.0f), finalScale);
+        float scaleFactor = GetScaleFactor(times[p0Index], times[p1Index], animationTime);
+        glm::vec3 finalScale = glm::mix(scales[p0Index], scales[p1Index], scaleFactor);
+        return finalScale;
     }
 };
 
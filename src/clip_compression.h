@@ -0,0 +1,339 @@
+//
+//  clip_compression.h
+//  skeletal_animation
+//
+
+#ifndef clip_compression_h
+#define clip_compression_h
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include "animation_clip.h"
+
+/* a rotation packed as "smallest three" into 48 bits: the largest component is dropped
+   (and rebuilt from the unit length), the other three are stored with 15 bits each over
+   [-1/sqrt(2), 1/sqrt(2)]. the index of the dropped component lives in the top bits of
+   the first two words. */
+inline void EncodeQuat48(glm::quat rotation, uint16_t* out)
+{
+    rotation = glm::normalize(rotation);
+    float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+    int largest = 0;
+    for (int i = 1; i < 4; ++i)
+    {
+        if (std::abs(components[i]) > std::abs(components[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, keep the dropped component positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    int word = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float normalized = components[i] * sign * glm::root_two<float>() * 0.5f + 0.5f;
+        normalized = std::min(std::max(normalized, 0.0f), 1.0f);
+        out[word++] = static_cast<uint16_t>(std::lround(normalized * 32767.0f));
+    }
+    out[0] |= static_cast<uint16_t>((largest & 1) << 15);
+    out[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+}
+
+inline glm::quat DecodeQuat48(const uint16_t* in)
+{
+    int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+    float components[4];
+    float sumOfSquares = 0.0f;
+    int word = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float normalized = (in[word++] & 0x7fff) * (1.0f / 32767.0f);
+        components[i] = (normalized * 2.0f - 1.0f) * glm::one_over_root_two<float>();
+        sumOfSquares += components[i] * components[i];
+    }
+    components[largest] = std::sqrt(std::max(0.0f, 1.0f - sumOfSquares));
+    return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+/* channel of a CompressedAnimationClip, vectors are quantized to 16 bits inside [rangeMin, rangeMin + rangeExtent] */
+struct CompressedChannel {
+    int frameOffset;  // into GetFrames()
+    int keyOffset;    // in keys of 3 words into GetPositions(), GetRotations() or GetScales()
+    int numKeys;
+    glm::vec3 rangeMin;
+    glm::vec3 rangeExtent;
+};
+
+struct CompressedTrack {
+    CompressedChannel position;
+    CompressedChannel rotation;
+    CompressedChannel scale;
+};
+
+/* AnimationClip quantized to 6 bytes per key plus a 16 bit frame index per key, keys are
+   decoded on the fly while sampling. uses the same single blob layout as AnimationClip.
+   a clip whose keys 16 bit frame indices cannot tell apart is not compressed, the result
+   then has no tracks. */
+class CompressedAnimationClip
+{
+public:
+    CompressedAnimationClip() = default;
+
+    explicit CompressedAnimationClip(const AnimationClip& clip)
+        : m_NumTracks(clip.GetNumTracks())
+    {
+        int numPositions = 0, numRotations = 0, numScales = 0;
+        for (int track = 0; track < m_NumTracks; ++track)
+        {
+            numPositions += clip.GetTrack(track).position.numKeys;
+            numRotations += clip.GetTrack(track).rotation.numKeys;
+            numScales += clip.GetTrack(track).scale.numKeys;
+        }
+        int numFrames = numPositions + numRotations + numScales;
+        if (!ChooseFrameStep(clip))
+        {
+            m_NumTracks = 0;
+            return;
+        }
+
+        m_TracksOffset = m_Blob.AddSection(m_NumTracks * sizeof(CompressedTrack));
+        m_FramesOffset = m_Blob.AddSection(numFrames * sizeof(uint16_t));
+        m_PositionsOffset = m_Blob.AddSection(numPositions * 3 * sizeof(uint16_t));
+        m_RotationsOffset = m_Blob.AddSection(numRotations * 3 * sizeof(uint16_t));
+        m_ScalesOffset = m_Blob.AddSection(numScales * 3 * sizeof(uint16_t));
+        m_Blob.Allocate();
+
+        CompressedTrack* tracks = m_Blob.Get<CompressedTrack>(m_TracksOffset);
+        int frameOffset = 0, positionOffset = 0, rotationOffset = 0, scaleOffset = 0;
+        m_Errors.resize(m_NumTracks);
+        for (int track = 0; track < m_NumTracks; ++track)
+        {
+            const TrackRange& source = clip.GetTrack(track);
+            tracks[track].position = PackVectors(clip.GetTimes(), clip.GetPositions(), source.position,
+                                                 frameOffset, positionOffset, m_Blob.Get<uint16_t>(m_PositionsOffset));
+            tracks[track].rotation = PackRotations(clip.GetTimes(), clip.GetRotations(), source.rotation,
+                                                   frameOffset, rotationOffset, m_Blob.Get<uint16_t>(m_RotationsOffset));
+            tracks[track].scale = PackVectors(clip.GetTimes(), clip.GetScales(), source.scale,
+                                              frameOffset, scaleOffset, m_Blob.Get<uint16_t>(m_ScalesOffset));
+
+            m_Errors[track].position = MeasureError(clip.GetTimes(), clip.GetPositions(), source.position, tracks[track].position, GetPositions());
+            m_Errors[track].rotation = MeasureError(clip.GetTimes(), clip.GetRotations(), source.rotation, tracks[track].rotation, GetRotations());
+            m_Errors[track].scale = MeasureError(clip.GetTimes(), clip.GetScales(), source.scale, tracks[track].scale, GetScales());
+        }
+    }
+
+    glm::vec3 SamplePosition(int track, float animationTime, int& cursor) const
+    {
+        return SampleChannel<glm::vec3>(GetTrack(track).position, GetPositions(), animationTime, cursor);
+    }
+
+    glm::quat SampleRotation(int track, float animationTime, int& cursor) const
+    {
+        return SampleChannel<glm::quat>(GetTrack(track).rotation, GetRotations(), animationTime, cursor);
+    }
+
+    glm::vec3 SampleScale(int track, float animationTime, int& cursor) const
+    {
+        return SampleChannel<glm::vec3>(GetTrack(track).scale, GetScales(), animationTime, cursor);
+    }
+
+    inline int GetNumTracks() const { return m_NumTracks; }
+    inline const CompressedTrack& GetTrack(int track) const { return m_Blob.Get<CompressedTrack>(m_TracksOffset)[track]; }
+    inline bool IsStaticTrack(int track) const
+    {
+        const CompressedTrack& range = GetTrack(track);
+        return range.position.numKeys <= 1 && range.rotation.numKeys <= 1 && range.scale.numKeys <= 1;
+    }
+    inline const uint16_t* GetFrames() const { return m_Blob.Get<uint16_t>(m_FramesOffset); }
+    inline const uint16_t* GetPositions() const { return m_Blob.Get<uint16_t>(m_PositionsOffset); }
+    inline const uint16_t* GetRotations() const { return m_Blob.Get<uint16_t>(m_RotationsOffset); }
+    inline const uint16_t* GetScales() const { return m_Blob.Get<uint16_t>(m_ScalesOffset); }
+    inline float GetFrameStep() const { return m_FrameStep; }
+    inline size_t GetSizeInBytes() const { return m_Blob.GetSizeInBytes(); }
+    /* largest deviation from the uncompressed keys, per track */
+    inline const TrackError& GetError(int track) const { return m_Errors[track]; }
+
+private:
+    SectionBlob m_Blob;
+    size_t m_TracksOffset = 0;
+    size_t m_FramesOffset = 0;
+    size_t m_PositionsOffset = 0;
+    size_t m_RotationsOffset = 0;
+    size_t m_ScalesOffset = 0;
+    int m_NumTracks = 0;
+    // ticks per frame index
+    float m_FrameStep = 1.0f;
+    float m_InvFrameStep = 1.0f;
+    std::vector<TrackError> m_Errors;
+
+    /* frame index of every key of source, strictly increasing. keys that round onto the
+       frame of the key before them move to the next frame */
+    template <typename F>
+    void ForEachFrame(const float* times, const ChannelRange& source, F&& frameOf) const
+    {
+        long frame = -1;
+        for (int key = 0; key < source.numKeys; ++key)
+        {
+            frame = std::max(std::lround(std::max(times[source.timeOffset + key], 0.0f) * m_InvFrameStep), frame + 1);
+            frameOf(key, frame);
+        }
+    }
+
+    /* baked clips key on a fixed frame rate, so the smallest gap between two keys of a
+       channel usually divides every key time and frame indices are exact. otherwise the key
+       range is split into 65535 steps. false when the frames of some channel do not fit in
+       16 bits, its keys are closer together than a step. */
+    bool ChooseFrameStep(const AnimationClip& clip)
+    {
+        static ChannelRange TrackRange::* const channels[] = { &TrackRange::position, &TrackRange::rotation, &TrackRange::scale };
+        const float* times = clip.GetTimes();
+        float maxTime = 0.0f;
+        float minGap = std::numeric_limits<float>::max();
+        for (int track = 0; track < m_NumTracks; ++track)
+        {
+            for (ChannelRange TrackRange::* channelOf : channels)
+            {
+                const ChannelRange& channel = clip.GetTrack(track).*channelOf;
+                const float* keyTimes = times + channel.timeOffset;
+                for (int key = 0; key < channel.numKeys; ++key)
+                {
+                    maxTime = std::max(maxTime, keyTimes[key]);
+                    // gaps are only taken between keys of the same channel
+                    if (key > 0 && keyTimes[key] > keyTimes[key - 1])
+                        minGap = std::min(minGap, keyTimes[key] - keyTimes[key - 1]);
+                }
+            }
+        }
+
+        bool exact = minGap < std::numeric_limits<float>::max() && maxTime / minGap <= 65535.0f;
+        for (int track = 0; exact && track < m_NumTracks; ++track)
+        {
+            for (ChannelRange TrackRange::* channelOf : channels)
+            {
+                const ChannelRange& channel = clip.GetTrack(track).*channelOf;
+                for (int key = 0; exact && key < channel.numKeys; ++key)
+                {
+                    float frame = times[channel.timeOffset + key] / minGap;
+                    exact = std::abs(frame - std::round(frame)) < 0.01f;
+                }
+            }
+        }
+
+        m_FrameStep = exact ? minGap : (maxTime > 0.0f ? maxTime / 65535.0f : 1.0f);
+        m_InvFrameStep = 1.0f / m_FrameStep;
+
+        long lastFrame = 0;
+        for (int track = 0; track < m_NumTracks; ++track)
+        {
+            for (ChannelRange TrackRange::* channelOf : channels)
+                ForEachFrame(times, clip.GetTrack(track).*channelOf, [&](int, long frame) { lastFrame = std::max(lastFrame, frame); });
+        }
+        return lastFrame <= 65535L;
+    }
+
+    void PackFrames(const float* times, const ChannelRange& source, int frameOffset)
+    {
+        uint16_t* frames = m_Blob.Get<uint16_t>(m_FramesOffset) + frameOffset;
+        ForEachFrame(times, source, [frames](int key, long frame) { frames[key] = static_cast<uint16_t>(frame); });
+    }
+
+    CompressedChannel PackVectors(const float* times, const glm::vec3* values, const ChannelRange& source,
+                                  int& frameOffset, int& keyOffset, uint16_t* words)
+    {
+        CompressedChannel channel = BeginChannel(source, frameOffset, keyOffset, times);
+        const glm::vec3* keys = values + source.keyOffset;
+        glm::vec3 rangeMax = source.numKeys > 0 ? keys[0] : glm::vec3(0.0f);
+        channel.rangeMin = rangeMax;
+        for (int key = 1; key < source.numKeys; ++key)
+        {
+            channel.rangeMin = glm::min(channel.rangeMin, keys[key]);
+            rangeMax = glm::max(rangeMax, keys[key]);
+        }
+        channel.rangeExtent = rangeMax - channel.rangeMin;
+
+        uint16_t* out = words + channel.keyOffset * 3;
+        for (int key = 0; key < source.numKeys; ++key)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float normalized = channel.rangeExtent[axis] > 0.0f ? (keys[key][axis] - channel.rangeMin[axis]) / channel.rangeExtent[axis] : 0.0f;
+                out[key * 3 + axis] = static_cast<uint16_t>(std::lround(normalized * 65535.0f));
+            }
+        }
+        return channel;
+    }
+
+    CompressedChannel PackRotations(const float* times, const glm::quat* values, const ChannelRange& source,
+                                    int& frameOffset, int& keyOffset, uint16_t* words)
+    {
+        CompressedChannel channel = BeginChannel(source, frameOffset, keyOffset, times);
+        channel.rangeMin = glm::vec3(0.0f);
+        channel.rangeExtent = glm::vec3(0.0f);
+        for (int key = 0; key < source.numKeys; ++key)
+            EncodeQuat48(values[source.keyOffset + key], words + (channel.keyOffset + key) * 3);
+        return channel;
+    }
+
+    CompressedChannel BeginChannel(const ChannelRange& source, int& frameOffset, int& keyOffset, const float* times)
+    {
+        CompressedChannel channel;
+        channel.frameOffset = frameOffset;
+        channel.keyOffset = keyOffset;
+        channel.numKeys = source.numKeys;
+        PackFrames(times, source, frameOffset);
+        frameOffset += source.numKeys;
+        keyOffset += source.numKeys;
+        return channel;
+    }
+
+    static glm::vec3 DecodeKey(const CompressedChannel& channel, const uint16_t* key, glm::vec3*)
+    {
+        return channel.rangeMin + channel.rangeExtent * glm::vec3(key[0], key[1], key[2]) * (1.0f / 65535.0f);
+    }
+
+    static glm::quat DecodeKey(const CompressedChannel&, const uint16_t* key, glm::quat*)
+    {
+        return DecodeQuat48(key);
+    }
+
+    template <typename T>
+    T SampleChannel(const CompressedChannel& channel, const uint16_t* words, float animationTime, int& cursor) const
+    {
+        const uint16_t* keys = words + channel.keyOffset * 3;
+        if (1 == channel.numKeys)
+            return DecodeKey(channel, keys, static_cast<T*>(nullptr));
+
+        const uint16_t* frames = GetFrames() + channel.frameOffset;
+        float frameTime = animationTime * m_InvFrameStep;
+        int p0Index = FindKeyIndex(frames, channel.numKeys, frameTime, cursor);
+        int p1Index = p0Index + 1;
+        float scaleFactor = (frameTime - frames[p0Index]) / static_cast<float>(frames[p1Index] - frames[p0Index]);
+        return InterpolateKeyValue(DecodeKey(channel, keys + p0Index * 3, static_cast<T*>(nullptr)),
+                                   DecodeKey(channel, keys + p1Index * 3, static_cast<T*>(nullptr)),
+                                   scaleFactor);
+    }
+
+    /* decoded track sampled at every source key time against the source key */
+    template <typename T>
+    float MeasureError(const float* times, const T* values, const ChannelRange& source,
+                       const CompressedChannel& channel, const uint16_t* words) const
+    {
+        float maxError = 0.0f;
+        int cursor = 0;
+        for (int key = 0; key < source.numKeys; ++key)
+        {
+            T decoded = SampleChannel<T>(channel, words, times[source.timeOffset + key], cursor);
+            maxError = std::max(maxError, KeyValueDistance(values[source.keyOffset + key], decoded));
+        }
+        return maxError;
+    }
+};
+
+#endif /* clip_compression_h */
@@ -0,0 +1,108 @@
+//
+//  clip_library.h
+//  skeletal_animation
+//
+
+#ifndef clip_library_h
+#define clip_library_h
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <cassert>
+#include <assimp/scene.h>
+#include "animation.h"
+#include "cooked_asset.h"
+#include "import_session.h"
+#include "model_animation.h"
+#include "skeleton_binding.h"
+
+/* every animation of a scene, imported in one pass. the clips share one skeleton binding and
+   are found by dense id, in the order of the file, or by name. clips without a name are called
+   "clip <id>", a name used twice finds the first clip with it. */
+class ClipLibrary
+{
+public:
+    ClipLibrary() = default;
+
+    ClipLibrary(const std::string& path, Model* model,
+                const AnimationImportSettings& settings = AnimationImportSettings())
+    {
+        ImportSession session(path, ImportProfile::AnimationOnly());
+        assert(session.HasHierarchy());
+        Load(session.GetScene(), model, settings);
+    }
+
+    /* every clip of a file that was already parsed, e.g. by the session model was built from */
+    ClipLibrary(const ImportSession& session, Model* model,
+                const AnimationImportSettings& settings = AnimationImportSettings())
+    {
+        assert(session.HasHierarchy());
+        Load(session.GetScene(), model, settings);
+    }
+
+    /* imports from a scene that is already in memory */
+    ClipLibrary(const aiScene* scene, Model* model,
+                const AnimationImportSettings& settings = AnimationImportSettings())
+    {
+        Load(scene, model, settings);
+    }
+
+    /* every clip of a cooked asset, which has to outlive the library. model is the Model built
+       from the same asset */
+    ClipLibrary(const CookedAsset& asset, Model* model)
+    {
+        m_Binding = std::make_shared<const SkeletonBinding>(asset.GetSkeleton(), model->GetBoneInfoMap());
+        for (int i = 0; i < asset.GetNumClips(); i++)
+            AddClip(new Animation(asset, i, m_Binding));
+    }
+
+    ClipLibrary(const ClipLibrary&) = delete;
+    ClipLibrary& operator=(const ClipLibrary&) = delete;
+
+    inline int GetNumClips() const { return static_cast<int>(m_Clips.size()); }
+    inline const Animation& GetClip(int id) const { return *m_Clips[id]; }
+    inline const std::shared_ptr<const SkeletonBinding>& GetBinding() const { return m_Binding; }
+
+    /* id of the clip called name, -1 when there is none */
+    int FindClip(const std::string& name) const
+    {
+        auto clip = m_ClipIDs.find(name);
+        return clip != m_ClipIDs.end() ? clip->second : -1;
+    }
+
+    /* names of all clips by id, e.g. for a UI list */
+    inline const std::vector<std::string>& GetClipNames() const { return m_ClipNames; }
+
+private:
+    std::shared_ptr<const SkeletonBinding> m_Binding;
+    // Animation is not copyable, its bones point into its own clip
+    std::vector<std::unique_ptr<Animation>> m_Clips;
+    std::vector<std::string> m_ClipNames;
+    std::map<std::string, int> m_ClipIDs;
+
+    void Load(const aiScene* scene, Model* model, const AnimationImportSettings& settings)
+    {
+        // the palette has to hold the bones of every clip before the shared binding is made
+        for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+            Animation::ReadMissingBones(scene->mAnimations[i], *model);
+        m_Binding = std::make_shared<const SkeletonBinding>(scene->mRootNode, model->GetBoneInfoMap());
+
+        for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+            AddClip(new Animation(scene->mAnimations[i], m_Binding, settings));
+    }
+
+    void AddClip(Animation* clip)
+    {
+        int id = static_cast<int>(m_Clips.size());
+        m_Clips.push_back(std::unique_ptr<Animation>(clip));
+        std::string name = clip->GetName();
+        if (name.empty())
+            name = "clip " + std::to_string(id);
+        m_ClipNames.push_back(name);
+        m_ClipIDs.insert(std::make_pair(name, id));
+    }
+};
+
+#endif /* clip_library_h */
@@ -0,0 +1,502 @@
+//
+//  cooked_asset.h
+//  skeletal_animation
+//
+
+#ifndef cooked_asset_h
+#define cooked_asset_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "animdata.h"
+#include "animation_clip.h"
+#include "skeleton.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* cooked asset: a model's meshes, skin, skeleton and clips in one binary file that is used in
+   place, with no parsing and no per element copying. the layout is
+
+     [CookedHeader][section][section]...
+
+   the header holds a directory with one entry per CookedSectionType, every section starts at
+   a 16 byte aligned offset from the start of the file. records refer to each other only by
+   index or byte offset, never by pointer, so the file can be mapped at any address. all
+   fields are little endian, strings are NUL terminated and referenced by their offset into
+   StringsSection. vertices, indices and clip blobs are stored exactly as Mesh uploads them and
+   AnimationClip samples them. */
+
+enum CookedSectionType {
+    StringsSection,         // char
+    MeshesSection,          // CookedMesh
+    VerticesSection,        // Vertex, the vertices of all meshes one after the other
+    IndicesSection,         // uint32_t, the same for indices
+    TexturesSection,        // CookedTexture
+    BonesSection,           // CookedBone, the entries of the model's bone info map
+    NodesSection,           // CookedNode, the skeleton in parent-before-child order
+    BindTransformsSection,  // glm::mat4, the bind transform of every node
+    ClipsSection,           // CookedClip
+    TracksSection,          // CookedTrack, the tracks of all clips one after the other
+    NodeTracksSection,      // int32_t, the track of every node for every clip
+    ClipDataSection,        // AnimationClip blobs, each 16 byte aligned
+    NumCookedSections
+};
+
+struct CookedSection {
+    uint64_t offset;  // from the start of the file
+    uint64_t size;    // in bytes
+};
+
+struct CookedHeader {
+    char magic[4];        // "SKAC"
+    uint32_t version;
+    uint32_t byteOrder;   // 0x01020304, reads differently on a host of the other byte order
+    uint32_t numSections;
+    uint64_t fileSize;
+    uint64_t sourceHash;  // of what the asset was cooked from, 0 when unknown
+    CookedSection sections[NumCookedSections];
+};
+
+struct CookedMesh {
+    uint32_t firstVertex;
+    uint32_t numVertices;
+    uint32_t firstIndex;
+    uint32_t numIndices;  // indices count from the mesh's first vertex
+    uint32_t firstTexture;
+    uint32_t numTextures;
+};
+
+struct CookedTexture {
+    uint32_t type;  // string, e.g. "texture_diffuse"
+    uint32_t path;  // string, relative to the directory of the file
+};
+
+struct CookedBone {
+    uint32_t name;  // string
+    int32_t id;     // slot of the final bone matrices
+    uint32_t reserved[2];
+    float offset[16];
+};
+
+struct CookedNode {
+    uint32_t name;  // string
+    int32_t parent; // -1 for the root
+};
+
+struct CookedClip {
+    uint32_t name;  // string
+    float duration;
+    float ticksPerSecond;
+    uint32_t firstTrack;
+    uint32_t firstNodeTrack;  // the clip's NodeTracksSection entries, one per node
+    uint32_t reserved;
+    uint64_t dataOffset;      // of the blob in ClipDataSection
+    AnimationClipLayout layout;
+};
+
+struct CookedTrack {
+    uint32_t name;   // string
+    int32_t boneID;  // -1 when the bone has no slot
+};
+
+// the records are written as is, these sizes are part of the format
+static_assert(sizeof(CookedHeader) == 32 + NumCookedSections * 16, "cooked header layout changed");
+static_assert(sizeof(CookedBone) == 80 && sizeof(CookedClip) == 128, "cooked record layout changed");
+static_assert(sizeof(AnimationClipLayout) == 96, "clip layout changed");
+static_assert(sizeof(Vertex) == 64 && sizeof(glm::mat4) == 64, "vertex or matrix layout changed");
+static_assert(sizeof(TrackRange) == 36 && sizeof(BoneTransform) == 40, "clip blob layout changed");
+
+inline bool IsLittleEndianHost()
+{
+    uint32_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+/* a whole file mapped read only. without mmap the file is read into 16 byte aligned memory */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path)
+    {
+#ifndef _WIN32
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return;
+        struct stat status;
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED)
+            {
+                m_Data = static_cast<const unsigned char*>(data);
+                m_Size = static_cast<size_t>(status.st_size);
+            }
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(file);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return;
+        m_Size = static_cast<size_t>(file.tellg());
+        m_Buffer.resize((m_Size + sizeof(glm::vec4) - 1) / sizeof(glm::vec4));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(m_Buffer.data()), m_Size);
+        m_Data = reinterpret_cast<const unsigned char*>(m_Buffer.data());
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (m_Data)
+            munmap(const_cast<unsigned char*>(m_Data), m_Size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline bool IsOpen() const { return m_Data != nullptr; }
+    inline const unsigned char* GetData() const { return m_Data; }
+    inline size_t GetSize() const { return m_Size; }
+
+private:
+    const unsigned char* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    std::vector<glm::vec4> m_Buffer;
+#endif
+};
+
+/* a cooked asset file mapped into memory. loading checks the header, the directory, that every
+   record and every key range points inside its section and that every index, bone id and track
+   the runtime follows is in range, so a corrupt file is rejected instead of read out of bounds. Model,
+   Animation and ClipLibrary have constructors that build from it. Meshes upload straight from
+   the mapping, Animations sample their keys from it, so it has to outlive those Animations. */
+class CookedAsset
+{
+public:
+    static const uint32_t Version = 1;
+
+    explicit CookedAsset(const std::string& path) : m_Path(path), m_File(path)
+    {
+        m_Valid = Validate();
+    }
+
+    CookedAsset(const CookedAsset&) = delete;
+    CookedAsset& operator=(const CookedAsset&) = delete;
+
+    /* whether path starts like a cooked asset, reads only the magic */
+    static bool IsCookedFile(const std::string& path)
+    {
+        char magic[4] = {};
+        std::ifstream file(path, std::ios::binary);
+        return file.read(magic, sizeof(magic)) && std::memcmp(magic, "SKAC", sizeof(magic)) == 0;
+    }
+
+    /* sourceHash of the cooked asset at path, read from its header alone. 0 when there is no
+       such file or it is not a cooked asset of this version */
+    static uint64_t ReadSourceHash(const std::string& path)
+    {
+        CookedHeader header;
+        std::ifstream file(path, std::ios::binary);
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return 0;
+        if (std::memcmp(header.magic, "SKAC", sizeof(header.magic)) != 0 || header.byteOrder != 0x01020304u
+            || header.version != Version)
+            return 0;
+        return header.sourceHash;
+    }
+
+    /* false when the file could not be mapped or failed a check, see GetError() */
+    inline bool IsValid() const { return m_Valid; }
+    inline const std::string& GetError() const { return m_Error; }
+    inline const std::string& GetPath() const { return m_Path; }
+    /* directory of the file, texture paths are relative to it */
+    inline std::string GetDirectory() const
+    {
+        size_t slash = m_Path.find_last_of('/');
+        return slash == std::string::npos ? std::string(".") : m_Path.substr(0, slash);
+    }
+    inline size_t GetSize() const { return m_File.GetSize(); }
+
+    inline const char* GetString(uint32_t offset) const { return Get<char>(StringsSection) + offset; }
+
+    inline int GetNumMeshes() const { return Count<CookedMesh>(MeshesSection); }
+    inline const CookedMesh& GetMesh(int mesh) const { return Get<CookedMesh>(MeshesSection)[mesh]; }
+    inline const Vertex* GetVertices() const { return Get<Vertex>(VerticesSection); }
+    inline const uint32_t* GetIndices() const { return Get<uint32_t>(IndicesSection); }
+    inline const CookedTexture* GetTextures() const { return Get<CookedTexture>(TexturesSection); }
+
+    inline int GetNumBones() const { return Count<CookedBone>(BonesSection); }
+    inline const CookedBone& GetBone(int bone) const { return Get<CookedBone>(BonesSection)[bone]; }
+
+    inline int GetNumNodes() const { return Count<CookedNode>(NodesSection); }
+    inline const CookedNode& GetNode(int node) const { return Get<CookedNode>(NodesSection)[node]; }
+    inline const glm::mat4* GetBindTransforms() const { return Get<glm::mat4>(BindTransformsSection); }
+
+    /* 0 when the asset is not valid */
+    inline int GetNumClips() const { return m_Valid ? Count<CookedClip>(ClipsSection) : 0; }
+    inline const CookedClip& GetClip(int clip) const { return Get<CookedClip>(ClipsSection)[clip]; }
+    inline const CookedTrack* GetTracks(int clip) const { return Get<CookedTrack>(TracksSection) + GetClip(clip).firstTrack; }
+    inline const int32_t* GetNodeTracks(int clip) const { return Get<int32_t>(NodeTracksSection) + GetClip(clip).firstNodeTrack; }
+    inline const void* GetClipData(int clip) const { return Get<unsigned char>(ClipDataSection) + GetClip(clip).dataOffset; }
+
+    /* the bone info map the model was cooked with */
+    void GetBoneInfoMap(std::map<std::string, BoneInfo>& boneInfoMap) const
+    {
+        for (int bone = 0; bone < GetNumBones(); bone++)
+        {
+            BoneInfo& info = boneInfoMap[GetString(GetBone(bone).name)];
+            info.id = GetBone(bone).id;
+            std::memcpy(&info.offset, GetBone(bone).offset, sizeof(info.offset));
+        }
+    }
+
+    /* empty when the asset is not valid */
+    Skeleton GetSkeleton() const
+    {
+        if (!m_Valid)
+            return Skeleton();
+        int numNodes = GetNumNodes();
+        std::vector<int> parents(numNodes);
+        std::vector<std::string> names(numNodes);
+        for (int node = 0; node < numNodes; node++)
+        {
+            parents[node] = GetNode(node).parent;
+            names[node] = GetString(GetNode(node).name);
+        }
+        return Skeleton(numNodes, parents.data(), GetBindTransforms(), names);
+    }
+
+private:
+    std::string m_Path;
+    MappedFile m_File;
+    const CookedHeader* m_Header = nullptr;
+    bool m_Valid = false;
+    std::string m_Error;
+
+    template <typename T>
+    const T* Get(CookedSectionType section) const
+    {
+        return reinterpret_cast<const T*>(m_File.GetData() + m_Header->sections[section].offset);
+    }
+
+    template <typename T>
+    int Count(CookedSectionType section) const
+    {
+        return static_cast<int>(m_Header->sections[section].size / sizeof(T));
+    }
+
+    bool Fail(const std::string& error)
+    {
+        m_Error = error;
+        return false;
+    }
+
+    /* whether first + count elements fit into a section of size elements, without overflowing */
+    static bool InRange(uint64_t first, uint64_t count, uint64_t size)
+    {
+        return first <= size && count <= size - first;
+    }
+
+    bool IsString(uint32_t offset) const
+    {
+        return offset < m_Header->sections[StringsSection].size;
+    }
+
+    /* a slot of the final bone matrices, or -1 for none */
+    static bool IsBoneSlot(int32_t id)
+    {
+        return id >= -1 && id < MAX_BONES;
+    }
+
+    bool Validate()
+    {
+        if (!m_File.IsOpen())
+            return Fail("cannot map " + m_Path);
+        if (!IsLittleEndianHost())
+            return Fail("cooked assets are little endian, this host is not");
+        if (m_File.GetSize() < sizeof(CookedHeader))
+            return Fail("file is too small");
+        m_Header = reinterpret_cast<const CookedHeader*>(m_File.GetData());
+        if (std::memcmp(m_Header->magic, "SKAC", sizeof(m_Header->magic)) != 0)
+            return Fail("not a cooked asset");
+        if (m_Header->byteOrder != 0x01020304u)
+            return Fail("wrong byte order");
+        if (m_Header->version != Version)
+            return Fail("version " + std::to_string(m_Header->version) + ", expected " + std::to_string(Version));
+        if (m_Header->numSections != NumCookedSections || m_Header->fileSize != m_File.GetSize())
+            return Fail("directory does not match the file");
+
+        static const size_t recordSizes[NumCookedSections] = {
+            1, sizeof(CookedMesh), sizeof(Vertex), sizeof(uint32_t), sizeof(CookedTexture), sizeof(CookedBone),
+            sizeof(CookedNode), sizeof(glm::mat4), sizeof(CookedClip), sizeof(CookedTrack), sizeof(int32_t), 1
+        };
+        for (int section = 0; section < NumCookedSections; section++)
+        {
+            const CookedSection& range = m_Header->sections[section];
+            if (range.offset % 16 != 0 || range.offset < sizeof(CookedHeader) || !InRange(range.offset, range.size, m_File.GetSize())
+                || range.size % recordSizes[section] != 0)
+                return Fail("section " + std::to_string(section) + " is out of place");
+        }
+        const CookedSection& strings = m_Header->sections[StringsSection];
+        if (strings.size > 0 && Get<char>(StringsSection)[strings.size - 1] != '\0')
+            return Fail("strings are not terminated");
+
+        return ValidateModel() && ValidateClips();
+    }
+
+    bool ValidateModel()
+    {
+        int numVertices = Count<Vertex>(VerticesSection);
+        int numIndices = Count<uint32_t>(IndicesSection);
+        int numTextures = Count<CookedTexture>(TexturesSection);
+        for (int mesh = 0; mesh < GetNumMeshes(); mesh++)
+        {
+            const CookedMesh& record = GetMesh(mesh);
+            if (!InRange(record.firstVertex, record.numVertices, numVertices) || !InRange(record.firstIndex, record.numIndices, numIndices)
+                || !InRange(record.firstTexture, record.numTextures, numTextures))
+                return Fail("mesh " + std::to_string(mesh) + " is out of range");
+            const uint32_t* indices = GetIndices() + record.firstIndex;
+            for (uint32_t index = 0; index < record.numIndices; index++)
+            {
+                if (indices[index] >= record.numVertices)
+                    return Fail("mesh " + std::to_string(mesh) + " indexes past its vertices");
+            }
+        }
+        for (int vertex = 0; vertex < numVertices; vertex++)
+        {
+            for (int influence = 0; influence < MAX_BONE_INFLUENCE; influence++)
+            {
+                if (!IsBoneSlot(GetVertices()[vertex].m_BoneIDs[influence]))
+                    return Fail("vertex " + std::to_string(vertex) + " has no bone slot");
+            }
+        }
+        for (int texture = 0; texture < numTextures; texture++)
+        {
+            if (!IsString(GetTextures()[texture].type) || !IsString(GetTextures()[texture].path))
+                return Fail("texture " + std::to_string(texture) + " is out of range");
+        }
+        for (int bone = 0; bone < GetNumBones(); bone++)
+        {
+            if (!IsString(GetBone(bone).name) || GetBone(bone).id < 0 || GetBone(bone).id >= MAX_BONES)
+                return Fail("bone " + std::to_string(bone) + " is out of range");
+        }
+        if (Count<glm::mat4>(BindTransformsSection) != GetNumNodes())
+            return Fail("every node needs a bind transform");
+        for (int node = 0; node < GetNumNodes(); node++)
+        {
+            if (!IsString(GetNode(node).name) || GetNode(node).parent >= node || GetNode(node).parent < -1)
+                return Fail("node " + std::to_string(node) + " is out of order");
+        }
+        return true;
+    }
+
+    bool ValidateClips()
+    {
+        int numTracks = Count<CookedTrack>(TracksSection);
+        int numNodeTracks = Count<int32_t>(NodeTracksSection);
+        uint64_t dataSize = m_Header->sections[ClipDataSection].size;
+        for (int clip = 0; clip < Count<CookedClip>(ClipsSection); clip++)
+        {
+            const CookedClip& record = GetClip(clip);
+            const AnimationClipLayout& layout = record.layout;
+            if (!IsString(record.name) || layout.numTracks < 0 || !InRange(record.firstTrack, layout.numTracks, numTracks)
+                || !InRange(record.firstNodeTrack, GetNumNodes(), numNodeTracks))
+                return Fail("clip " + std::to_string(clip) + " is out of range");
+            if (record.dataOffset % 16 != 0 || !InRange(record.dataOffset, layout.size, dataSize) || !ValidateClipKeys(record))
+                return Fail("keys of clip " + std::to_string(clip) + " are out of range");
+            for (int track = 0; track < layout.numTracks; track++)
+            {
+                const CookedTrack& cooked = GetTracks(clip)[track];
+                if (!IsString(cooked.name) || !IsBoneSlot(cooked.boneID))
+                    return Fail("track " + std::to_string(track) + " of clip " + std::to_string(clip) + " is out of range");
+            }
+            for (int node = 0; node < GetNumNodes(); node++)
+            {
+                if (GetNodeTracks(clip)[node] < -1 || GetNodeTracks(clip)[node] >= layout.numTracks)
+                    return Fail("node tracks of clip " + std::to_string(clip) + " are out of range");
+            }
+        }
+        return true;
+    }
+
+    /* the sections of a clip blob follow each other in the order AnimationClip lays them out,
+       16 byte aligned. every channel of the track table has to point into the times and keys,
+       and every animated track list entry has to be a track with more than one key of its
+       channel type, samplers interpolate those without checking. */
+    bool ValidateClipKeys(const CookedClip& record) const
+    {
+        const AnimationClipLayout& layout = record.layout;
+        const uint64_t sections[] = { layout.tracksOffset, layout.timesOffset, layout.positionsOffset, layout.rotationsOffset,
+                                      layout.scalesOffset, layout.staticPoseOffset, layout.animatedTracksOffset, layout.size };
+        const int numSections = sizeof(sections) / sizeof(sections[0]);
+        for (int section = 0; section + 1 < numSections; section++)
+        {
+            if (sections[section] % 16 != 0 || sections[section] > sections[section + 1])
+                return false;
+        }
+        uint64_t numTracks = static_cast<uint64_t>(layout.numTracks);
+        uint64_t numAnimated = 0;
+        for (int type = 0; type < NumChannelTypes; type++)
+        {
+            if (layout.numAnimatedTracks[type] < 0 || layout.numAnimatedTracks[type] > layout.numTracks)
+                return false;
+            numAnimated += static_cast<uint64_t>(layout.numAnimatedTracks[type]);
+        }
+        if (numTracks * sizeof(TrackRange) > layout.timesOffset - layout.tracksOffset
+            || numTracks * sizeof(BoneTransform) > layout.animatedTracksOffset - layout.staticPoseOffset
+            || numAnimated * sizeof(int32_t) > layout.size - layout.animatedTracksOffset)
+            return false;
+
+        static ChannelRange TrackRange::* const channels[NumChannelTypes] = { &TrackRange::position, &TrackRange::rotation, &TrackRange::scale };
+        uint64_t numTimes = (layout.positionsOffset - layout.timesOffset) / sizeof(float);
+        const uint64_t numKeys[NumChannelTypes] = {
+            (layout.rotationsOffset - layout.positionsOffset) / sizeof(glm::vec3),
+            (layout.scalesOffset - layout.rotationsOffset) / sizeof(glm::quat),
+            (layout.staticPoseOffset - layout.scalesOffset) / sizeof(glm::vec3)
+        };
+        // a view of the blob, nothing is copied
+        AnimationClip keys(layout, Get<unsigned char>(ClipDataSection) + record.dataOffset);
+        for (int track = 0; track < layout.numTracks; track++)
+        {
+            for (int type = 0; type < NumChannelTypes; type++)
+            {
+                const ChannelRange& channel = keys.GetTrack(track).*channels[type];
+                if (channel.timeOffset < 0 || channel.keyOffset < 0 || channel.numKeys < 0
+                    || !InRange(channel.timeOffset, channel.numKeys, numTimes) || !InRange(channel.keyOffset, channel.numKeys, numKeys[type]))
+                    return false;
+            }
+        }
+        for (int type = 0; type < NumChannelTypes; type++)
+        {
+            const int* animated = keys.GetAnimatedTracks(static_cast<ChannelType>(type));
+            for (int entry = 0; entry < layout.numAnimatedTracks[type]; entry++)
+            {
+                if (animated[entry] < 0 || animated[entry] >= layout.numTracks || (keys.GetTrack(animated[entry]).*channels[type]).numKeys < 2)
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif /* cooked_asset_h */
@@ -0,0 +1,305 @@
+//
+//  cooked_asset_writer.h
+//  skeletal_animation
+//
+
+#ifndef cooked_asset_writer_h
+#define cooked_asset_writer_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+#include "cooked_asset.h"
+#include "model_animation.h"
+#include "animation.h"
+#include "clip_library.h"
+
+/* directory of path, "." when path has none */
+inline std::string DirectoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+/* the components of path made absolute against the working directory, without "." and ".." */
+inline std::vector<std::string> AbsolutePathComponents(const std::string& path)
+{
+    std::string absolute = path;
+    bool isAbsolute = !path.empty() && (path[0] == '/' || (path.size() > 1 && path[1] == ':'));
+    if (!isAbsolute)
+    {
+        char workingDirectory[4096];
+#ifdef _WIN32
+        bool found = _getcwd(workingDirectory, sizeof(workingDirectory)) != nullptr;
+#else
+        bool found = getcwd(workingDirectory, sizeof(workingDirectory)) != nullptr;
+#endif
+        absolute = (found ? std::string(workingDirectory) : std::string()) + "/" + path;
+    }
+    std::vector<std::string> components;
+    size_t begin = 0;
+    while (begin <= absolute.size())
+    {
+        size_t end = absolute.find_first_of("/\\", begin);
+        if (end == std::string::npos)
+            end = absolute.size();
+        std::string component = absolute.substr(begin, end - begin);
+        if (component == ".." && !components.empty())
+            components.pop_back();
+        else if (!component.empty() && component != "." && component != "..")
+            components.push_back(component);
+        begin = end + 1;
+    }
+    return components;
+}
+
+/* how the directory to is reached from the directory from, "." when they are the same */
+inline std::string RelativeDirectory(const std::string& from, const std::string& to)
+{
+    std::vector<std::string> fromComponents = AbsolutePathComponents(from);
+    std::vector<std::string> toComponents = AbsolutePathComponents(to);
+    size_t common = 0;
+    while (common < fromComponents.size() && common < toComponents.size() && fromComponents[common] == toComponents[common])
+        common++;
+    std::string relative;
+    for (size_t i = common; i < fromComponents.size(); i++)
+        relative += relative.empty() ? ".." : "/..";
+    for (size_t i = common; i < toComponents.size(); i++)
+        relative += (relative.empty() ? "" : "/") + toComponents[i];
+    return relative.empty() ? std::string(".") : relative;
+}
+
+/* builds the bytes of a cooked asset, see cooked_asset.h for the layout */
+class CookedAssetWriter
+{
+public:
+    /* model and the clips imported for it, which all have to share one skeleton. clips imported
+       compressed cannot be cooked, their float keys are gone. sourceHash is stored in the header
+       for tools that cook incrementally. texture paths are relative to the model's directory,
+       textureDirectory is that directory as seen from where the cooked asset is saved */
+    bool Write(const Model& model, const std::vector<const Animation*>& clips, uint64_t sourceHash = 0,
+               const std::string& textureDirectory = ".")
+    {
+        m_Sections.assign(NumCookedSections, std::vector<unsigned char>());
+        m_Strings.clear();
+        for (const Animation* clip : clips)
+        {
+            if (clip->IsCompressed())
+                return Fail("clip \"" + clip->GetName() + "\" was imported compressed");
+            if (!clip->GetSkeleton().Matches(clips[0]->GetSkeleton()))
+                return Fail("clip \"" + clip->GetName() + "\" has a different skeleton");
+        }
+
+        WriteModel(model, textureDirectory);
+        if (!clips.empty())
+            WriteSkeleton(clips[0]->GetSkeleton());
+        for (const Animation* clip : clips)
+            WriteClip(*clip);
+        Assemble(sourceHash);
+        return true;
+    }
+
+    inline const std::vector<unsigned char>& GetBytes() const { return m_Bytes; }
+    inline const std::string& GetError() const { return m_Error; }
+
+    bool Save(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        return file.write(reinterpret_cast<const char*>(m_Bytes.data()), m_Bytes.size()) && file.flush();
+    }
+
+private:
+    std::vector<std::vector<unsigned char>> m_Sections;
+    std::map<std::string, uint32_t> m_Strings;
+    std::vector<unsigned char> m_Bytes;
+    std::string m_Error;
+
+    bool Fail(const std::string& error)
+    {
+        m_Error = error;
+        return false;
+    }
+
+    static size_t Align(size_t size)
+    {
+        return (size + 15) / 16 * 16;
+    }
+
+    template <typename T>
+    void Append(CookedSectionType section, const T* values, size_t count)
+    {
+        std::vector<unsigned char>& bytes = m_Sections[section];
+        const unsigned char* first = reinterpret_cast<const unsigned char*>(values);
+        bytes.insert(bytes.end(), first, first + count * sizeof(T));
+    }
+
+    template <typename T>
+    void Append(CookedSectionType section, const T& value)
+    {
+        Append(section, &value, 1);
+    }
+
+    template <typename T>
+    uint32_t Count(CookedSectionType section) const
+    {
+        return static_cast<uint32_t>(m_Sections[section].size() / sizeof(T));
+    }
+
+    /* offset of string in StringsSection, every distinct string is stored once */
+    uint32_t AddString(const std::string& string)
+    {
+        auto existing = m_Strings.find(string);
+        if (existing != m_Strings.end())
+            return existing->second;
+        uint32_t offset = static_cast<uint32_t>(m_Sections[StringsSection].size());
+        Append(StringsSection, string.c_str(), string.size() + 1);
+        m_Strings.insert(std::make_pair(string, offset));
+        return offset;
+    }
+
+    void WriteModel(const Model& model, const std::string& textureDirectory)
+    {
+        for (const Mesh& mesh : model.meshes)
+        {
+            CookedMesh record = {};
+            record.firstVertex = Count<Vertex>(VerticesSection);
+            record.numVertices = static_cast<uint32_t>(mesh.vertices.size());
+            record.firstIndex = Count<uint32_t>(IndicesSection);
+            record.numIndices = static_cast<uint32_t>(mesh.indices.size());
+            record.firstTexture = Count<CookedTexture>(TexturesSection);
+            record.numTextures = static_cast<uint32_t>(mesh.textures.size());
+            Append(VerticesSection, mesh.vertices.data(), mesh.vertices.size());
+            Append(IndicesSection, mesh.indices.data(), mesh.indices.size());
+            for (const Texture& texture : mesh.textures)
+            {
+                CookedTexture cooked;
+                cooked.type = AddString(texture.type);
+                cooked.path = AddString(textureDirectory == "." ? texture.path : textureDirectory + "/" + texture.path);
+                Append(TexturesSection, cooked);
+            }
+            Append(MeshesSection, record);
+        }
+
+        for (const auto& boneInfo : model.GetBoneInfoMap())
+        {
+            CookedBone bone = {};
+            bone.name = AddString(boneInfo.first);
+            bone.id = boneInfo.second.id;
+            std::memcpy(bone.offset, &boneInfo.second.offset, sizeof(bone.offset));
+            Append(BonesSection, bone);
+        }
+    }
+
+    void WriteSkeleton(const Skeleton& skeleton)
+    {
+        for (int node = 0; node < skeleton.GetNumNodes(); node++)
+        {
+            CookedNode record;
+            record.name = AddString(skeleton.GetName(node));
+            record.parent = skeleton.GetParents()[node];
+            Append(NodesSection, record);
+        }
+        Append(BindTransformsSection, skeleton.GetBindTransforms(), skeleton.GetNumNodes());
+    }
+
+    void WriteClip(const Animation& animation)
+    {
+        const AnimationClip& clip = animation.GetClip();
+        CookedClip record = {};
+        record.name = AddString(animation.GetName());
+        record.duration = animation.GetDuration();
+        record.ticksPerSecond = animation.GetTicksPerSecond();
+        record.firstTrack = Count<CookedTrack>(TracksSection);
+        record.firstNodeTrack = Count<int32_t>(NodeTracksSection);
+        // blobs are 16 byte aligned inside, and so is every blob's start
+        std::vector<unsigned char>& data = m_Sections[ClipDataSection];
+        data.resize(Align(data.size()), 0);
+        record.dataOffset = data.size();
+        record.layout = clip.GetLayout();
+        Append(ClipDataSection, clip.GetData(), clip.GetSizeInBytes());
+        Append(ClipsSection, record);
+
+        for (int track = 0; track < animation.GetNumTracks(); track++)
+        {
+            CookedTrack cooked;
+            cooked.name = AddString(animation.GetTrackName(track));
+            cooked.boneID = animation.GetBone(track).GetBoneID();
+            Append(TracksSection, cooked);
+        }
+        const int* nodeTracks = animation.GetNodeTracks();
+        for (int node = 0; node < animation.GetSkeleton().GetNumNodes(); node++)
+            Append(NodeTracksSection, static_cast<int32_t>(nodeTracks[node]));
+    }
+
+    void Assemble(uint64_t sourceHash)
+    {
+        CookedHeader header = {};
+        std::memcpy(header.magic, "SKAC", sizeof(header.magic));
+        header.version = CookedAsset::Version;
+        header.byteOrder = 0x01020304u;
+        header.numSections = NumCookedSections;
+        header.sourceHash = sourceHash;
+
+        size_t offset = Align(sizeof(CookedHeader));
+        for (int section = 0; section < NumCookedSections; section++)
+        {
+            header.sections[section].offset = offset;
+            header.sections[section].size = m_Sections[section].size();
+            offset = Align(offset + m_Sections[section].size());
+        }
+        header.fileSize = offset;
+
+        m_Bytes.assign(offset, 0);
+        std::memcpy(m_Bytes.data(), &header, sizeof(header));
+        for (int section = 0; section < NumCookedSections; section++)
+        {
+            if (!m_Sections[section].empty())
+                std::memcpy(&m_Bytes[header.sections[section].offset], m_Sections[section].data(), m_Sections[section].size());
+        }
+    }
+};
+
+/* cooks model and clips into path, prints what went wrong to log and returns false on failure.
+   texture paths are rewritten to be relative to the directory of path, where CookedAsset looks
+   them up, so the textures stay where they are */
+inline bool WriteCookedAsset(const std::string& path, const Model& model, const std::vector<const Animation*>& clips,
+                             uint64_t sourceHash = 0, std::ostream& log = std::cout)
+{
+    if (!IsLittleEndianHost())
+    {
+        log << "ERROR::COOKED:: cooked assets are little endian, this host is not" << std::endl;
+        return false;
+    }
+    CookedAssetWriter writer;
+    if (!writer.Write(model, clips, sourceHash, RelativeDirectory(DirectoryOf(path), model.directory)))
+    {
+        log << "ERROR::COOKED:: " << writer.GetError() << std::endl;
+        return false;
+    }
+    if (!writer.Save(path))
+    {
+        log << "ERROR::COOKED:: cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/* the same for every clip of a library */
+inline bool WriteCookedAsset(const std::string& path, const Model& model, const ClipLibrary& library,
+                             uint64_t sourceHash = 0, std::ostream& log = std::cout)
+{
+    std::vector<const Animation*> clips;
+    for (int clip = 0; clip < library.GetNumClips(); clip++)
+        clips.push_back(&library.GetClip(clip));
+    return WriteCookedAsset(path, model, clips, sourceHash, log);
+}
+
+#endif /* cooked_asset_writer_h */
@@ -0,0 +1,160 @@
+//
+//  import_session.h
+//  skeletal_animation
+//
+
+#ifndef import_session_h
+#define import_session_h
+
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <assimp/Importer.hpp>
+#include <assimp/config.h>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+/* which post-processing steps an import runs and the importer properties they read */
+struct ImportProfile {
+    const char* name;
+    unsigned int flags;         // aiProcess_* steps
+    int maxBoneWeights;         // AI_CONFIG_PP_LBW_MAX_WEIGHTS, read by aiProcess_LimitBoneWeights
+    int removeComponents;       // AI_CONFIG_PP_RVC_FLAGS, aiComponent_* read by aiProcess_RemoveComponent
+
+    /* what the renderer draws: triangles with normals, shared vertices, at most 4 bone weights
+       per vertex (MAX_BONE_INFLUENCE, Model drops any weight beyond that) and an index order
+       suited to the vertex cache. tangents, colors, lights and cameras are dropped. */
+    static const ImportProfile& RuntimeMinimal()
+    {
+        static const ImportProfile profile = {
+            "runtime-minimal",
+            aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices |
+            aiProcess_LimitBoneWeights | aiProcess_ImproveCacheLocality | aiProcess_RemoveComponent,
+            4,
+            aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_COLORS | aiComponent_LIGHTS | aiComponent_CAMERAS
+        };
+        return profile;
+    }
+
+    /* only the node hierarchy and the clips, meshes are not post-processed at all. bone offsets
+       come from the meshes, so the Model has to be imported from its own file */
+    static const ImportProfile& AnimationOnly()
+    {
+        static const ImportProfile profile = {
+            "animation-only",
+            aiProcess_RemoveComponent,
+            4,
+            aiComponent_MESHES | aiComponent_MATERIALS | aiComponent_TEXTURES | aiComponent_LIGHTS | aiComponent_CAMERAS
+        };
+        return profile;
+    }
+
+    /* everything assimp can give the renderer, including tangents for normal mapping, checked
+       by the validator */
+    static const ImportProfile& FullQuality()
+    {
+        static const ImportProfile profile = {
+            "full-quality",
+            aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
+            aiProcess_JoinIdenticalVertices | aiProcess_LimitBoneWeights | aiProcess_ImproveCacheLocality |
+            aiProcess_ValidateDataStructure,
+            4,
+            0
+        };
+        return profile;
+    }
+
+    /* the profile called name, nullptr when there is none */
+    static const ImportProfile* Find(const std::string& name)
+    {
+        const ImportProfile* profiles[] = { &RuntimeMinimal(), &AnimationOnly(), &FullQuality() };
+        for (const ImportProfile* profile : profiles)
+        {
+            if (name == profile->name)
+                return profile;
+        }
+        return nullptr;
+    }
+};
+
+/* what an import read and how long it took */
+struct ImportStats {
+    double milliseconds = 0.0;  // parsing and post-processing
+    unsigned int numMeshes = 0;
+    unsigned int numVertices = 0;
+    unsigned int numIndices = 0;
+    unsigned int numBones = 0;
+    unsigned int numAnimations = 0;
+};
+
+/* one parse of an asset file. the meshes, the skin, the node hierarchy and the clips of a Model
+   and its Animations are all read from the same aiScene, so a file is parsed once however many
+   objects are built from it. the scene belongs to the session and goes away with it, nothing
+   built from it keeps a pointer into it. */
+class ImportSession
+{
+public:
+    explicit ImportSession(const std::string& path, const ImportProfile& profile = ImportProfile::RuntimeMinimal())
+        : m_Path(path), m_Profile(profile)
+    {
+        m_Importer.SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, profile.maxBoneWeights);
+        m_Importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, profile.removeComponents);
+        auto start = std::chrono::steady_clock::now();
+        m_Scene = m_Importer.ReadFile(path, profile.flags);
+        m_Stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        CountStats();
+    }
+
+    ImportSession(const ImportSession&) = delete;
+    ImportSession& operator=(const ImportSession&) = delete;
+
+    /* the file was read and has a node hierarchy, enough for the clips */
+    inline bool HasHierarchy() const { return m_Scene && m_Scene->mRootNode; }
+    /* assimp also found everything a Model needs, files holding only clips are incomplete */
+    inline bool IsComplete() const { return HasHierarchy() && !(m_Scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE); }
+
+    inline const aiScene* GetScene() const { return m_Scene; }
+    inline const std::string& GetPath() const { return m_Path; }
+    /* directory of the file, textures are looked up relative to it */
+    inline std::string GetDirectory() const
+    {
+        size_t slash = m_Path.find_last_of('/');
+        return slash == std::string::npos ? std::string(".") : m_Path.substr(0, slash);
+    }
+    inline const char* GetErrorString() const { return m_Importer.GetErrorString(); }
+    inline const ImportProfile& GetProfile() const { return m_Profile; }
+    inline const ImportStats& GetStats() const { return m_Stats; }
+
+    void PrintStats(std::ostream& out = std::cout) const
+    {
+        out << "import " << m_Path << " (" << m_Profile.name << "): " << m_Stats.milliseconds << " ms, "
+                  << m_Stats.numMeshes << " meshes, " << m_Stats.numVertices << " vertices, "
+                  << m_Stats.numIndices << " indices, " << m_Stats.numBones << " bones, "
+                  << m_Stats.numAnimations << " clips" << std::endl;
+    }
+
+private:
+    Assimp::Importer m_Importer;
+    std::string m_Path;
+    ImportProfile m_Profile;
+    const aiScene* m_Scene = nullptr;
+    ImportStats m_Stats;
+
+    void CountStats()
+    {
+        if (!m_Scene)
+            return;
+        m_Stats.numMeshes = m_Scene->mNumMeshes;
+        m_Stats.numAnimations = m_Scene->mNumAnimations;
+        for (unsigned int i = 0; i < m_Scene->mNumMeshes; i++)
+        {
+            const aiMesh* mesh = m_Scene->mMeshes[i];
+            m_Stats.numVertices += mesh->mNumVertices;
+            m_Stats.numBones += mesh->mNumBones;
+            for (unsigned int face = 0; face < mesh->mNumFaces; face++)
+                m_Stats.numIndices += mesh->mFaces[face].mNumIndices;
+        }
+    }
+};
+
+#endif /* import_session_h */
@@ -0,0 +1,169 @@
+//
+//  job_system.h
+//  skeletal_animation
+//
+
+#ifndef job_system_h
+#define job_system_h
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+/* work stealing thread pool. ParallelFor cuts a range into chunks and gives every thread a
+   contiguous run of them in its own queue. a thread works through its queue front to back and,
+   once it runs dry, steals chunks from the back of the other queues. the calling thread takes
+   part as thread 0, so a JobSystem with one thread simply runs everything inline. queues keep
+   their memory between calls, so a ParallelFor does not allocate once they have grown. */
+class JobSystem
+{
+public:
+    explicit JobSystem(int numThreads = static_cast<int>(std::thread::hardware_concurrency()))
+        : m_NumThreads(std::max(numThreads, 1))
+    {
+        for (int i = 0; i < m_NumThreads; i++)
+            m_Queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        for (int i = 1; i < m_NumThreads; i++)
+            m_Workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_WorkAvailable.notify_all();
+        for (std::thread& worker : m_Workers)
+            worker.join();
+    }
+
+    inline int GetNumThreads() const { return m_NumThreads; }
+
+    /* calls job(begin, end) for every chunk of at most chunkSize indices in [0, count) and
+       returns once all of them have finished. chunks may run in any order on any thread. */
+    void ParallelFor(int count, int chunkSize, const std::function<void(int, int)>& job)
+    {
+        chunkSize = std::max(chunkSize, 1);
+        int numChunks = (count + chunkSize - 1) / chunkSize;
+        if (numChunks == 0)
+            return;
+        if (m_NumThreads == 1 || numChunks == 1)
+        {
+            job(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (int thread = 0; thread < m_NumThreads; thread++)
+            {
+                Queue& queue = *m_Queues[thread];
+                std::lock_guard<std::mutex> queueLock(queue.mutex);
+                queue.tasks.clear();
+                queue.front = 0;
+                int firstChunk = numChunks * thread / m_NumThreads;
+                int lastChunk = numChunks * (thread + 1) / m_NumThreads;
+                for (int chunk = firstChunk; chunk < lastChunk; chunk++)
+                    queue.tasks.push_back(Task{ &job, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize) });
+            }
+            m_Pending = numChunks;
+            m_Generation++;
+        }
+        m_WorkAvailable.notify_all();
+
+        RunTasks(0);
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_AllDone.wait(lock, [this] { return m_Pending == 0; });
+    }
+
+private:
+    struct Task {
+        const std::function<void(int, int)>* job;
+        int begin;
+        int end;
+    };
+
+    // tasks before front were taken by the owner, tasks past the end were stolen
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Task> tasks;
+        size_t front = 0;
+    };
+
+    int m_NumThreads;
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    std::vector<std::thread> m_Workers;
+
+    // guards m_Pending, m_Generation and m_Stop
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkAvailable;
+    std::condition_variable m_AllDone;
+    int m_Pending = 0;
+    unsigned int m_Generation = 0;
+    bool m_Stop = false;
+
+    bool PopTask(int thread, Task& task)
+    {
+        Queue& own = *m_Queues[thread];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.front == own.tasks.size())
+            return false;
+        task = own.tasks[own.front++];
+        return true;
+    }
+
+    bool StealTask(int thread, Task& task)
+    {
+        for (int offset = 1; offset < m_NumThreads; offset++)
+        {
+            Queue& victim = *m_Queues[(thread + offset) % m_NumThreads];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.front == victim.tasks.size())
+                continue;
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void RunTasks(int thread)
+    {
+        Task task;
+        while (PopTask(thread, task) || StealTask(thread, task))
+        {
+            (*task.job)(task.begin, task.end);
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (--m_Pending == 0)
+                m_AllDone.notify_all();
+        }
+    }
+
+    void WorkerLoop(int thread)
+    {
+        unsigned int seenGeneration = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_WorkAvailable.wait(lock, [&] { return m_Stop || m_Generation != seenGeneration; });
+                if (m_Stop)
+                    return;
+                seenGeneration = m_Generation;
+            }
+            RunTasks(thread);
+        }
+    }
+};
+
+#endif /* job_system_h */
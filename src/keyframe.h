@@ -0,0 +1,306 @@
+//
+//  keyframe.h
+//  skeletal_animation
+//
+
+#ifndef keyframe_h
+#define keyframe_h
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <assimp/scene.h>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+#include "assimp_glm_helpers.h"
+
+/* remembers the key segment each track was last sampled at, so steady playback
+   only has to look at the next key instead of scanning from key 0 */
+struct KeyframeCursor {
+    int position = 0;
+    int rotation = 0;
+    int scale = 0;
+};
+
+/* returns the index i such that times[i] <= animationTime < times[i + 1],
+   clamped to [0, numKeys - 2]. numKeys has to be at least 2. times are float
+   ticks or quantized frame indices. */
+template <typename Time>
+int FindKeyIndex(const Time* times, int numKeys, float animationTime, int& cursor)
+{
+    int index = cursor;
+    if (index < numKeys - 1 && times[index] <= animationTime)
+    {
+        // still inside the segment of the last frame
+        if (animationTime < times[index + 1])
+            return index;
+        // monotonic playback crossed into the next segment
+        if (index + 2 < numKeys && animationTime < times[index + 2])
+        {
+            cursor = index + 1;
+            return cursor;
+        }
+    }
+    else if (animationTime < times[1])
+    {
+        // playhead wrapped around (fmod in Animator::UpdateAnimation)
+        cursor = 0;
+        return cursor;
+    }
+
+    // random seek or scrubbing, fall back to binary search
+    const Time* next = std::upper_bound(times + 1, times + numKeys, animationTime);
+    index = static_cast<int>(next - times) - 1;
+    cursor = std::min(index, numKeys - 2);
+    return cursor;
+}
+
+inline glm::vec3 InterpolateKeyValue(const glm::vec3& a, const glm::vec3& b, float factor)
+{
+    return glm::mix(a, b, factor);
+}
+
+inline glm::quat InterpolateKeyValue(const glm::quat& a, const glm::quat& b, float factor)
+{
+    return glm::normalize(glm::slerp(a, b, factor));
+}
+
+inline float KeyValueDistance(const glm::vec3& a, const glm::vec3& b)
+{
+    return glm::length(a - b);
+}
+
+/* angle between two rotations. the chord between the unit quaternions is 2 sin(angle / 4), unlike
+   the acos of their dot product it still resolves angles below 1e-3 radians in float */
+inline float KeyValueDistance(const glm::quat& a, const glm::quat& b)
+{
+    glm::quat na = glm::normalize(a), nb = glm::normalize(b);
+    // q and -q are the same rotation
+    float chord = std::min(glm::length(na - nb), glm::length(na + nb));
+    return 4.0f * std::asin(std::min(1.0f, chord * 0.5f));
+}
+
+/* equality up to float noise. exporters often bake a value that never changes into a key on every
+   frame, those channels should not be mistaken for animated ones. */
+const float ConstantKeyEpsilon = 1e-6f;
+
+inline bool KeyValuesEqual(const glm::vec3& a, const glm::vec3& b)
+{
+    return glm::all(glm::lessThanEqual(glm::abs(a - b), glm::vec3(ConstantKeyEpsilon)));
+}
+
+inline bool KeyValuesEqual(const glm::quat& a, const glm::quat& b)
+{
+    // q and -q are the same rotation
+    glm::vec4 va(a.x, a.y, a.z, a.w), vb(b.x, b.y, b.z, b.w);
+    glm::vec4 epsilon(ConstantKeyEpsilon);
+    return glm::all(glm::lessThanEqual(glm::abs(va - vb), epsilon)) ||
+           glm::all(glm::lessThanEqual(glm::abs(va + vb), epsilon));
+}
+
+/* evaluates a key track at animationTime, holding the first/last key outside of its range */
+template <typename T>
+T SampleKeys(const float* times, const T* values, int numKeys, float animationTime, int& cursor)
+{
+    if (numKeys == 1)
+        return values[0];
+
+    int index = FindKeyIndex(times, numKeys, animationTime, cursor);
+    float factor = (animationTime - times[index]) / (times[index + 1] - times[index]);
+    factor = std::min(std::max(factor, 0.0f), 1.0f);
+    return InterpolateKeyValue(values[index], values[index + 1], factor);
+}
+
+/* keys of one channel while importing, times and values kept in separate arrays */
+template <typename T>
+struct KeyChannel {
+    std::vector<float> times;
+    std::vector<T> values;
+
+    int Size() const { return static_cast<int>(times.size()); }
+
+    T Sample(float animationTime, int& cursor) const
+    {
+        return SampleKeys(times.data(), values.data(), Size(), animationTime, cursor);
+    }
+
+    /* collapses a channel whose keys all hold the same value into that single key,
+       returns the number of removed keys */
+    int FoldConstant()
+    {
+        int numKeys = Size();
+        for (int keyIndex = 1; keyIndex < numKeys; ++keyIndex)
+        {
+            if (!KeyValuesEqual(values[0], values[keyIndex]))
+                return 0;
+        }
+        if (numKeys > 1)
+        {
+            times.resize(1);
+            values.resize(1);
+        }
+        return std::max(numKeys - 1, 0);
+    }
+
+    /* replaces the keys by samples taken every sampleInterval ticks over [0, duration] and
+       returns the largest distance between the resampled track and the source keys */
+    float Resample(float duration, float sampleInterval)
+    {
+        if (Size() < 2)
+            return 0.0f;
+
+        int numSamples = std::max(2, static_cast<int>(std::ceil(duration / sampleInterval)) + 1);
+        KeyChannel samples;
+        samples.times.resize(numSamples);
+        samples.values.resize(numSamples);
+        int cursor = 0;
+        for (int sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex)
+        {
+            samples.times[sampleIndex] = sampleIndex * sampleInterval;
+            samples.values[sampleIndex] = Sample(samples.times[sampleIndex], cursor);
+        }
+
+        // both tracks are piecewise linear and the samples lie on the source curve,
+        // so the deviation peaks at one of the source key times
+        float maxError = 0.0f;
+        cursor = 0;
+        for (int keyIndex = 0; keyIndex < Size(); ++keyIndex)
+        {
+            float error = KeyValueDistance(values[keyIndex], samples.Sample(times[keyIndex], cursor));
+            maxError = std::max(maxError, error);
+        }
+
+        *this = samples;
+        return maxError;
+    }
+
+    /* drops every key that linear interpolation between the kept neighbours reproduces
+       within maxDistance, returns the number of removed keys */
+    int Reduce(float maxDistance)
+    {
+        int numKeys = Size();
+        if (numKeys < 2)
+            return 0;
+
+        // the whole channel fits into one constant key
+        bool constant = true;
+        for (int keyIndex = 1; constant && keyIndex < numKeys; ++keyIndex)
+            constant = KeyValueDistance(values[0], values[keyIndex]) <= maxDistance;
+        if (constant)
+        {
+            times.resize(1);
+            values.resize(1);
+            return numKeys - 1;
+        }
+
+        KeyChannel reduced;
+        reduced.times.push_back(times[0]);
+        reduced.values.push_back(values[0]);
+        int anchor = 0;
+        for (int end = 2; end < numKeys; ++end)
+        {
+            if (!Reproduces(anchor, end, maxDistance))
+            {
+                anchor = end - 1;
+                reduced.times.push_back(times[anchor]);
+                reduced.values.push_back(values[anchor]);
+            }
+        }
+        reduced.times.push_back(times[numKeys - 1]);
+        reduced.values.push_back(values[numKeys - 1]);
+
+        *this = reduced;
+        return numKeys - Size();
+    }
+
+private:
+    /* whether interpolating from key first to key last stays within maxDistance of every key in between */
+    bool Reproduces(int first, int last, float maxDistance) const
+    {
+        for (int keyIndex = first + 1; keyIndex < last; ++keyIndex)
+        {
+            float factor = (times[keyIndex] - times[first]) / (times[last] - times[first]);
+            T interpolated = InterpolateKeyValue(values[first], values[last], factor);
+            if (KeyValueDistance(values[keyIndex], interpolated) > maxDistance)
+                return false;
+        }
+        return true;
+    }
+};
+
+/* largest deviation a resampled or compressed track has from its source keys */
+struct TrackError {
+    float position = 0.0f;
+    float rotation = 0.0f;  // radians
+    float scale = 0.0f;
+};
+
+/* keyframes of one aiNodeAnim channel as read at import time, packed into an AnimationClip afterwards */
+struct BoneKeys {
+    std::string name;
+    KeyChannel<glm::vec3> positions;
+    KeyChannel<glm::quat> rotations;
+    KeyChannel<glm::vec3> scales;
+    TrackError resampleError;
+
+    explicit BoneKeys(const aiNodeAnim* channel) : name(channel->mNodeName.data)
+    {
+        for (unsigned int positionIndex = 0; positionIndex < channel->mNumPositionKeys; ++positionIndex)
+        {
+            positions.times.push_back(channel->mPositionKeys[positionIndex].mTime);
+            positions.values.push_back(AssimpGLMHelpers::GetGLMVec(channel->mPositionKeys[positionIndex].mValue));
+        }
+
+        for (unsigned int rotationIndex = 0; rotationIndex < channel->mNumRotationKeys; ++rotationIndex)
+        {
+            rotations.times.push_back(channel->mRotationKeys[rotationIndex].mTime);
+            rotations.values.push_back(AssimpGLMHelpers::GetGLMQuat(channel->mRotationKeys[rotationIndex].mValue));
+        }
+
+        for (unsigned int keyIndex = 0; keyIndex < channel->mNumScalingKeys; ++keyIndex)
+        {
+            scales.times.push_back(channel->mScalingKeys[keyIndex].mTime);
+            scales.values.push_back(AssimpGLMHelpers::GetGLMVec(channel->mScalingKeys[keyIndex].mValue));
+        }
+    }
+
+    int GetNumKeys() const { return positions.Size() + rotations.Size() + scales.Size(); }
+    int GetNumAnimatedChannels() const { return (positions.Size() > 1) + (rotations.Size() > 1) + (scales.Size() > 1); }
+
+    /* folds every channel that never changes into a single key, returns the number of removed keys */
+    int FoldConstantChannels()
+    {
+        return positions.FoldConstant() + rotations.FoldConstant() + scales.FoldConstant();
+    }
+
+    /* resample every animated channel to one key per sampleInterval ticks over [0, duration] */
+    void Resample(float duration, float sampleInterval)
+    {
+        resampleError.position = positions.Resample(duration, sampleInterval);
+        resampleError.rotation = rotations.Resample(duration, sampleInterval);
+        resampleError.scale = scales.Resample(duration, sampleInterval);
+    }
+
+    /* removes keys as long as no channel on its own moves a joint of the subtree by more than
+       channelTolerance in model space. an error at this bone moves the whole subtree below it: a
+       rotation error of a radians displaces points reach away from the joint by up to a * reach,
+       a scale error s by about s * reach. reach is measured in model space, parentScale is the
+       scale the ancestors apply to this bone's local translation. the errors of all channels down
+       a chain add up, the caller splits its budget between them. angleTolerance, when set, also
+       caps the rotation error itself. */
+    int Reduce(float channelTolerance, float angleTolerance, float reach, float parentScale)
+    {
+        float lever = std::max(reach, 1e-6f);
+        float maxAngle = channelTolerance / lever;
+        if (angleTolerance > 0.0f)
+            maxAngle = std::min(maxAngle, angleTolerance);
+
+        int removed = positions.Reduce(channelTolerance / std::max(parentScale, 1e-6f));
+        removed += rotations.Reduce(maxAngle);
+        removed += scales.Reduce(channelTolerance / lever);
+        return removed;
+    }
+};
+
+#endif /* keyframe_h */
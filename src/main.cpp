@@ -25,6 +25,7 @@
 
 #include <iostream>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <unistd.h>
 
@@ -121,9 +122,32 @@ int main(int argc, const char * argv[]) {
     // build and compile shaders
     Shader animShader(vertexShaderPath, fragmentShaderPath);
     
-    // load models
-    Model animModel(modelPath);
-    Animation animation(modelPath, &animModel);
+    // load models, a cooked asset is mapped as is, anything else is parsed once for both the
+    // meshes and the clip. the animation samples its keys from the cooked asset's mapping
+    std::unique_ptr<CookedAsset> cookedAsset;
+    std::unique_ptr<Model> loadedModel;
+    std::unique_ptr<Animation> loadedAnimation;
+    if (CookedAsset::IsCookedFile(modelPath))
+    {
+        cookedAsset.reset(new CookedAsset(modelPath));
+        if (!cookedAsset->IsValid() || cookedAsset->GetNumClips() == 0)
+        {
+            std::cout << "Failed to load cooked asset: " << cookedAsset->GetError() << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        loadedModel.reset(new Model(*cookedAsset));
+        loadedAnimation.reset(new Animation(*cookedAsset, loadedModel.get()));
+    }
+    else
+    {
+        ImportSession session(modelPath);
+        session.PrintStats();
+        loadedModel.reset(new Model(session));
+        loadedAnimation.reset(new Animation(session, loadedModel.get()));
+    }
+    Model& animModel = *loadedModel;
+    Animation& animation = *loadedAnimation;
     Animator animator(&animation);
         
     // imgui
@@ -133,6 +157,12 @@ int main(int argc, const char * argv[]) {
 
 //    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+    std::vector<std::string> boneMatrixUniforms;
+    for (size_t i = 0; i < animator.GetFinalBoneMatrices().size(); ++i)
+        boneMatrixUniforms.push_back("finalBonesMatrices[" + std::to_string(i) + "]");
+    // the animator starts at version 0 with its identity palette, which was never uploaded
+    unsigned int uploadedPoseVersion = ~0u;
+
     // render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -146,10 +176,11 @@ int main(int argc, const char * argv[]) {
         else
         {
             // Normal
-            if (single_animation_items[item_current] != "None")
+            // items are "None" followed by the animated bones in track order
+            if (item_current > 0)
             {
                 isPlayingSingleBone = true;
-                animator.setCurrentPlayedBone(single_animation_items[item_current]);
+                animator.setCurrentPlayedTrack(item_current - 1);
             }
             // Single Skeleton
             else
@@ -176,11 +207,15 @@ int main(int argc, const char * argv[]) {
         animShader.setMat4("projection", projection);
         animShader.setMat4("view", view);
         
-        auto transforms = animator.GetFinalBoneMatrices();
-
-        for (int i = 0; i < transforms.size(); ++i)
+        // uniforms keep their values, so the palette is only uploaded when the pose changed
+        if (animator.GetPoseVersion() != uploadedPoseVersion)
         {
-            animShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);    
+            const std::vector<glm::mat4>& transforms = animator.GetFinalBoneMatrices();
+            for (size_t i = 0; i < transforms.size(); ++i)
+            {
+                animShader.setMat4(boneMatrixUniforms[i], transforms[i]);
+            }
+            uploadedPoseVersion = animator.GetPoseVersion();
         }
 
         // render the loaded model
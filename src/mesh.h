@@ -18,6 +18,8 @@
 #include <vector>
 
 #define MAX_BONE_INFLUENCE 4
+// slots of the final bone matrices, the size of the array in the skinning shader
+#define MAX_BONES 100
 
 struct Vertex {
     // position
@@ -46,14 +48,29 @@ public:
     std::vector<Texture> textures;
     unsigned int VAO;
     
-    Mesh (std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+    // without upload no OpenGL call is made and the mesh only keeps its data, e.g. to be cooked
+    // offline, it cannot be drawn
+    Mesh (std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, bool upload = true)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
         
         // set the vertex buffers and its attribute pointers
-        setupMesh();
+        if (upload)
+            setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+        else
+        {
+            VAO = VBO = EBO = 0;
+            numIndices = static_cast<unsigned int>(this->indices.size());
+        }
+    }
+    // uploads vertices and indices straight from memory the caller owns, e.g. a mapped cooked
+    // asset. the vertices and indices vectors stay empty, the mesh data only lives on the GPU
+    Mesh (const Vertex* vertexData, size_t numVertices, const unsigned int* indexData, size_t indexCount, std::vector<Texture> meshTextures)
+    {
+        textures = meshTextures;
+        setupMesh(vertexData, numVertices, indexData, indexCount);
     }
     // render the mesh
     void Draw(Shader &shader)
@@ -86,7 +103,7 @@ public:
         
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
         
         // set everything back to defaults
@@ -96,10 +113,12 @@ public:
 private:
     // render data
     unsigned int VBO, EBO;
+    unsigned int numIndices;
     
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex* vertexData, size_t numVertices, const unsigned int* indexData, size_t indexCount)
     {
+        numIndices = static_cast<unsigned int>(indexCount);
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -108,10 +127,10 @@ private:
         glBindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
         
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
         
         // set the vertex attribute pointers
         // glVertexAttribPointer(index, size, type, normalized, stride, pointer)
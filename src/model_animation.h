@@ -13,9 +13,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <stb_image.h>
-#include <assimp/Importer.hpp>
 #include <assimp/scene.h>
-#include <assimp/postprocess.h>
 
 #include "mesh.h"
 #include "shader.h"
@@ -27,9 +25,12 @@
 #include <map>
 #include <vector>
 #include <functional>
+#include <algorithm>
 
 #include "animdata.h"
 #include "assimp_glm_helpers.h"
+#include "import_session.h"
+#include "cooked_asset.h"
 
 class Model
 {
@@ -39,11 +40,26 @@ public:
     std::vector<Mesh>    meshes;
     std::string directory;
     bool gammaCorrection;
+    bool uploadToGPU;    // false only for headless tools, meshes and textures are then never uploaded
     
     // constructor, expected a path for 3D model
-    Model (std::string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model (std::string const &path, bool gamma = false) : gammaCorrection(gamma), uploadToGPU(true)
     {
-        loadModel(path);
+        ImportSession session(path);
+        loadModel(session);
+    }
+    // constructor, reads the meshes of a scene that was already parsed, e.g. to build the
+    // model's Animations from the same session afterwards. without upload it needs no OpenGL
+    // context, texture files are only checked. errors go to log, std::cout when null
+    Model (const ImportSession &session, bool gamma = false, bool upload = true, std::ostream* log = nullptr)
+        : gammaCorrection(gamma), uploadToGPU(upload), m_Log(log)
+    {
+        loadModel(session);
+    }
+    // constructor, uploads the meshes of a cooked asset straight from its mapping
+    Model (const CookedAsset &asset, bool gamma = false) : gammaCorrection(gamma), uploadToGPU(true)
+    {
+        loadCookedModel(asset);
     }
     void Draw(Shader &shader)
     {
@@ -52,29 +68,58 @@ public:
     }
     
     std::map<std::string, BoneInfo>& GetBoneInfoMap() { return m_BoneInfoMap; }
+    const std::map<std::string, BoneInfo>& GetBoneInfoMap() const { return m_BoneInfoMap; }
     int& GetBoneCount() {return m_BoneCounter; }
 private:
     std::map<std::string, BoneInfo> m_BoneInfoMap;
     int m_BoneCounter = 0;
+    std::ostream* m_Log = nullptr;
     
-    void loadModel(std::string const &path)
+    std::ostream& Log() { return m_Log ? *m_Log : std::cout; }
+    
+    void loadModel(const ImportSession &session)
     {
-        // read file via assimp
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
         // check for errors
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        if (!session.IsComplete())
         {
-            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            Log() << "ERROR::ASSIMP:: " << session.GetErrorString() << std::endl;
             return;
         }
+        const aiScene* scene = session.GetScene();
         // retrieve the directory path of filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        directory = session.GetDirectory();
         
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
     }
     
+    void loadCookedModel(const CookedAsset &asset)
+    {
+        if (!asset.IsValid())
+        {
+            std::cout << "ERROR::COOKED:: " << asset.GetError() << std::endl;
+            return;
+        }
+        directory = asset.GetDirectory();
+        
+        for (int i = 0; i < asset.GetNumMeshes(); i++)
+        {
+            const CookedMesh& mesh = asset.GetMesh(i);
+            std::vector<Texture> textures;
+            for (unsigned int j = 0; j < mesh.numTextures; j++)
+            {
+                const CookedTexture& texture = asset.GetTextures()[mesh.firstTexture + j];
+                textures.push_back(loadTexture(asset.GetString(texture.path), asset.GetString(texture.type)));
+            }
+            meshes.push_back(Mesh(asset.GetVertices() + mesh.firstVertex, mesh.numVertices,
+                                  asset.GetIndices() + mesh.firstIndex, mesh.numIndices, textures));
+        }
+        
+        asset.GetBoneInfoMap(m_BoneInfoMap);
+        for (auto& boneInfo : m_BoneInfoMap)
+            m_BoneCounter = std::max(m_BoneCounter, boneInfo.second.id + 1);
+    }
+    
     // process a node in a recursively fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
     void processNode(aiNode *node, const aiScene *scene)
     {
@@ -201,7 +246,7 @@ private:
         
         ExtractBoneWeightForVertices(vertices, mesh, scene);
         
-        return Mesh(vertices, indices, textures);
+        return Mesh(vertices, indices, textures, uploadToGPU);
     }
     
     unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false)
@@ -244,6 +289,17 @@ private:
         return textureID;
     }
     
+    // reads only the header of the image, enough to know the texture will load
+    bool CheckTextureFile(const char* path, const std::string& textureDirectory)
+    {
+        std::string filename = textureDirectory + '/' + std::string(path);
+        int width, height, nrComponents;
+        if (stbi_info(filename.c_str(), &width, &height, &nrComponents))
+            return true;
+        Log() << "Texture failed to load at path: " << path << std::endl;
+        return false;
+    }
+    
     std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName)
     {
         std::vector<Texture> textures;
@@ -251,30 +307,29 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading as a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true;
-                    break;
-                }
-            }
-            if (!skip)
-            {
-                // load the texture if not yet loaded
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
         return textures;
     }
+    
+    Texture loadTexture(const char* path, const std::string& typeName)
+    {
+        // check if texture was loaded before and if so, skip loading as a new texture
+        for (unsigned int j = 0; j < textures_loaded.size(); j++)
+        {
+            if (std::strcmp(textures_loaded[j].path.data(), path) == 0)
+                return textures_loaded[j];
+        }
+        // load the texture if not yet loaded
+        Texture texture;
+        texture.id = uploadToGPU ? TextureFromFile(path, this->directory) : 0;
+        if (!uploadToGPU)
+            CheckTextureFile(path, this->directory);
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);
+        return texture;
+    }
 };
 
 #endif /* model_animation_h */
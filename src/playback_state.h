@@ -0,0 +1,33 @@
+//
+//  playback_state.h
+//  skeletal_animation
+//
+
+#ifndef playback_state_h
+#define playback_state_h
+
+#include <vector>
+#include "keyframe.h"
+#include "pose.h"
+
+/* everything that changes while one character plays a clip. clips, bones and the skeleton are
+   read-only once loaded, so any number of instances on any number of threads can share one
+   Animation as long as each has its own PlaybackState. */
+struct PlaybackState {
+    std::vector<KeyframeCursor> cursors;    // indexed by track
+    std::vector<BoneTransform> localPose;   // indexed by track
+    const void* source = nullptr;           // what the state was bound to
+
+    /* resets the cursors and seeds the pose with the rest pose. constant channels are
+       never sampled, they keep the value written here. */
+    void Bind(const void* clip, const BoneTransform* restPose, int numTracks)
+    {
+        source = clip;
+        cursors.assign(numTracks, KeyframeCursor());
+        localPose.assign(restPose, restPose + numTracks);
+    }
+
+    inline bool IsBoundTo(const void* clip) const { return source == clip; }
+};
+
+#endif /* playback_state_h */
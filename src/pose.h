@@ -0,0 +1,46 @@
+//
+//  pose.h
+//  skeletal_animation
+//
+
+#ifndef pose_h
+#define pose_h
+
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+
+/* local transform of a bone kept as translation, rotation and scale (40 bytes instead of
+   a 64 byte mat4). it only becomes a matrix while concatenating into model space. */
+struct BoneTransform {
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    /* same as translate(translation) * toMat4(rotation) * scale(scale) */
+    glm::mat4 ToMatrix() const
+    {
+        glm::mat3 rotationMatrix = glm::mat3_cast(rotation);
+        glm::mat4 matrix;
+        matrix[0] = glm::vec4(rotationMatrix[0] * scale.x, 0.0f);
+        matrix[1] = glm::vec4(rotationMatrix[1] * scale.y, 0.0f);
+        matrix[2] = glm::vec4(rotationMatrix[2] * scale.z, 0.0f);
+        matrix[3] = glm::vec4(translation, 1.0f);
+        return matrix;
+    }
+};
+
+/* parent * local.ToMatrix() for an affine parent, without building the local matrix */
+inline glm::mat4 ConcatenateTransform(const glm::mat4& parent, const BoneTransform& local)
+{
+    glm::mat3 parentLinear(parent);
+    glm::mat3 localLinear = parentLinear * glm::mat3_cast(local.rotation);
+    glm::mat4 global;
+    global[0] = glm::vec4(localLinear[0] * local.scale.x, 0.0f);
+    global[1] = glm::vec4(localLinear[1] * local.scale.y, 0.0f);
+    global[2] = glm::vec4(localLinear[2] * local.scale.z, 0.0f);
+    global[3] = glm::vec4(parentLinear * local.translation + glm::vec3(parent[3]), 1.0f);
+    return global;
+}
+
+#endif /* pose_h */
@@ -0,0 +1,192 @@
+//
+//  pose_blend.h
+//  skeletal_animation
+//
+
+#ifndef pose_blend_h
+#define pose_blend_h
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include "animation.h"
+#include "batch_sampler.h"
+#include "playback_state.h"
+#include "pose.h"
+
+static_assert(sizeof(BoneTransform) == 10 * sizeof(float), "pose blending treats a BoneTransform as 10 floats");
+
+/* pose buffers borrowed from a stack owned by the calling thread. scratch poses are returned in
+   the reverse order they were taken, when the PoseScratch goes out of scope, and keep their
+   memory, so once a thread has blended its largest poses blending never allocates again. */
+class PoseScratch
+{
+public:
+    /* count poses of numNodes bones each, one after the other */
+    PoseScratch(int numNodes, int count = 1) : m_Pool(GetPool()), m_NumNodes(numNodes)
+    {
+        if (m_Pool.used == m_Pool.buffers.size())
+            m_Pool.buffers.push_back(std::vector<BoneTransform>());
+        std::vector<BoneTransform>& buffer = m_Pool.buffers[m_Pool.used++];
+        size_t size = static_cast<size_t>(numNodes) * count;
+        if (buffer.size() < size)
+        {
+            buffer.resize(size);
+            m_Pool.allocations++;
+        }
+        m_Poses = buffer.data();
+    }
+
+    ~PoseScratch()
+    {
+        m_Pool.used--;
+    }
+
+    PoseScratch(const PoseScratch&) = delete;
+    PoseScratch& operator=(const PoseScratch&) = delete;
+
+    inline BoneTransform* Get(int pose = 0) const { return m_Poses + static_cast<size_t>(pose) * m_NumNodes; }
+
+    /* times the calling thread's scratch memory had to grow */
+    static size_t GetNumAllocations() { return GetPool().allocations; }
+
+private:
+    struct Pool {
+        std::vector<std::vector<BoneTransform>> buffers;
+        size_t used = 0;
+        size_t allocations = 0;
+    };
+
+    Pool& m_Pool;
+    int m_NumNodes;
+    BoneTransform* m_Poses;
+
+    static Pool& GetPool()
+    {
+        static thread_local Pool pool;
+        return pool;
+    }
+};
+
+/* local transform of every skeleton node at time, nodes animation does not animate keep their
+   bind pose. float clips are sampled in one batch, compressed clips bone by bone. */
+inline void SamplePose(const Animation& animation, float time, PlaybackState& state, BoneTransform* pose)
+{
+    if (!state.IsBoundTo(&animation))
+        animation.BindPlayback(state);
+    bool batch = animation.GetClip().GetNumTracks() > 0;
+    if (batch)
+        BatchSampler::Sample(animation.GetClip(), time, state);
+
+    const int* nodeTracks = animation.GetNodeTracks();
+    const BoneTransform* bindPoses = animation.GetSkeleton().GetBindPoses();
+    for (int node = 0; node < animation.GetSkeleton().GetNumNodes(); node++)
+    {
+        int track = nodeTracks[node];
+        if (track < 0)
+        {
+            pose[node] = bindPoses[node];
+            continue;
+        }
+        if (!batch)
+            animation.GetBone(track).Sample(time, state.cursors[track], state.localPose[track]);
+        pose[node] = state.localPose[track];
+    }
+}
+
+/* a pose is 10 floats per bone and every one of them blends linearly, so the weighted sums run
+   over the whole array four floats at a time. rotations are then moved onto the shortest arc
+   and renormalized bone by bone, which makes the result an nlerp. */
+namespace PoseBlend
+{
+    inline float* Floats(BoneTransform* pose) { return reinterpret_cast<float*>(pose); }
+    inline const float* Floats(const BoneTransform* pose) { return reinterpret_cast<const float*>(pose); }
+
+    /* out = a * weightA + b * weightB over count floats */
+    inline void WeightedSum(const float* a, float weightA, const float* b, float weightB, int count, float* out)
+    {
+        Float4 wa = Float4::Broadcast(weightA);
+        Float4 wb = Float4::Broadcast(weightB);
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+            (Float4::LoadUnaligned(a + i) * wa + Float4::LoadUnaligned(b + i) * wb).StoreUnaligned(out + i);
+        for (; i < count; i++)
+            out[i] = a[i] * weightA + b[i] * weightB;
+    }
+
+    /* out = a * weight over count floats */
+    inline void Scale(const float* a, float weight, int count, float* out)
+    {
+        Float4 w = Float4::Broadcast(weight);
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+            (Float4::LoadUnaligned(a + i) * w).StoreUnaligned(out + i);
+        for (; i < count; i++)
+            out[i] = a[i] * weight;
+    }
+
+    inline float Dot(const glm::quat& a, const glm::quat& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    }
+
+    inline void Normalize(glm::quat& q)
+    {
+        float length = std::sqrt(Dot(q, q));
+        if (length > 0.0f)
+            q = q * (1.0f / length);
+        else
+            q = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+}
+
+/* out = nlerp(a, b, weight) bone by bone over count bones, out must not overlap a or b */
+inline void BlendPoses(const BoneTransform* a, const BoneTransform* b, float weight, int count, BoneTransform* out)
+{
+    PoseBlend::WeightedSum(PoseBlend::Floats(a), 1.0f - weight, PoseBlend::Floats(b), weight, count * 10, PoseBlend::Floats(out));
+    for (int bone = 0; bone < count; bone++)
+    {
+        // b's rotation was added with the wrong sign, take it out twice
+        if (PoseBlend::Dot(a[bone].rotation, b[bone].rotation) < 0.0f)
+            out[bone].rotation = out[bone].rotation - b[bone].rotation * (2.0f * weight);
+        PoseBlend::Normalize(out[bone].rotation);
+    }
+}
+
+/* weighted nlerp of numPoses poses of count bones into out, which must not overlap any of them.
+   weights are not negative and are normalized by their sum, all rotations are taken on the side
+   of the first pose. */
+inline void BlendPoses(const BoneTransform* const* poses, const float* weights, int numPoses, int count, BoneTransform* out)
+{
+    if (numPoses == 0)
+        return;
+    float sum = 0.0f;
+    for (int pose = 0; pose < numPoses; pose++)
+        sum += weights[pose];
+    if (sum <= 0.0f)
+    {
+        std::copy(poses[0], poses[0] + count, out);
+        return;
+    }
+
+    int numFloats = count * 10;
+    float* accumulated = PoseBlend::Floats(out);
+    PoseBlend::Scale(PoseBlend::Floats(poses[0]), weights[0] / sum, numFloats, accumulated);
+    for (int pose = 1; pose < numPoses; pose++)
+    {
+        float weight = weights[pose] / sum;
+        if (weight <= 0.0f)
+            continue;
+        PoseBlend::WeightedSum(accumulated, 1.0f, PoseBlend::Floats(poses[pose]), weight, numFloats, accumulated);
+        for (int bone = 0; bone < count; bone++)
+        {
+            if (PoseBlend::Dot(poses[0][bone].rotation, poses[pose][bone].rotation) < 0.0f)
+                out[bone].rotation = out[bone].rotation - poses[pose][bone].rotation * (2.0f * weight);
+        }
+    }
+    for (int bone = 0; bone < count; bone++)
+        PoseBlend::Normalize(out[bone].rotation);
+}
+
+#endif /* pose_blend_h */
@@ -0,0 +1,154 @@
+//
+//  pose_cache.h
+//  skeletal_animation
+//
+
+#ifndef pose_cache_h
+#define pose_cache_h
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+
+class Animation;
+
+/* what a pose depends on besides the animation data */
+struct PoseKey {
+    const Animation* animation = nullptr;
+    bool playing = false;
+    int64_t time = 0;         // sample time from PoseCache::TimeKey, 0 while not playing
+    int playedTrack = -2;     // -2 when all bones play
+    bool dropDetailBones = false;
+
+    bool operator==(const PoseKey& other) const
+    {
+        return animation == other.animation && playing == other.playing && time == other.time &&
+               playedTrack == other.playedTrack && dropDetailBones == other.dropDetailBones;
+    }
+};
+
+struct PoseKeyHash {
+    size_t operator()(const PoseKey& key) const
+    {
+        size_t hash = std::hash<const void*>()(key.animation);
+        hash = hash * 31 + std::hash<int64_t>()(key.time);
+        hash = hash * 31 + static_cast<size_t>(key.playedTrack + 2);
+        return hash * 4 + (key.playing ? 2 : 0) + (key.dropDetailBones ? 1 : 0);
+    }
+};
+
+/* per frame cache of bone palettes, shared by the animators of a crowd. the first animator that
+   evaluates a key stores its palette, later ones with the same clip, sample time and bone mask
+   copy it instead of sampling and walking the hierarchy.
+
+   with a time step, sample times snap to multiples of it, so instances a fraction of a step
+   apart share one pose. without one the key holds the exact sample time and a hit is bit
+   identical to evaluating the pose. the cache is emptied by BeginFrame and may be used from
+   many threads at once. */
+class PoseCache
+{
+public:
+    /* timeStep in ticks, 0 keeps sample times exact */
+    explicit PoseCache(float timeStep = 0.0f) : m_TimeStep(timeStep)
+    {
+    }
+
+    PoseCache(const PoseCache&) = delete;
+    PoseCache& operator=(const PoseCache&) = delete;
+
+    inline void SetTimeStep(float timeStep) { m_TimeStep = timeStep; }
+    inline float GetTimeStep() const { return m_TimeStep; }
+
+    /* forgets the poses of the last frame and restarts the hit counts */
+    void BeginFrame()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Entries.clear();
+        m_NumPalettes = 0;
+        m_Hits = 0;
+        m_Misses = 0;
+    }
+
+    /* the time a playhead at time is sampled at. snapped times are exact multiples of the time
+       step, so equal keys always come from the same frame index. a time rounded up to the
+       duration wraps to the start. */
+    float QuantizeTime(float time, float duration) const
+    {
+        if (m_TimeStep <= 0.0f)
+            return time;
+        float quantized = std::floor(time / m_TimeStep + 0.5f) * m_TimeStep;
+        return quantized < duration ? quantized : 0.0f;
+    }
+
+    /* a sample time snapped to timeStep as an integer for PoseKey: the index of its time step,
+       or with a time step of 0 the bits of the exact time, offset past every step index. -0 and
+       0 give the same key. */
+    static int64_t TimeKey(float sampleTime, float timeStep)
+    {
+        if (timeStep > 0.0f)
+            return static_cast<int64_t>(std::floor(sampleTime / timeStep + 0.5f));
+        // adding 0 turns -0 into 0
+        float time = sampleTime + 0.0f;
+        uint32_t timeBits;
+        std::memcpy(&timeBits, &time, sizeof(float));
+        return (int64_t(1) << 32) + timeBits;
+    }
+
+    /* copies the palette stored for key into palette, returns false on a miss */
+    bool Fetch(const PoseKey& key, std::vector<glm::mat4>& palette)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto entry = m_Entries.find(key);
+            if (entry != m_Entries.end())
+            {
+                palette = m_Palettes[entry->second];
+                m_Hits++;
+                return true;
+            }
+        }
+        m_Misses++;
+        return false;
+    }
+
+    /* stores palette under key, unless another animator got there first */
+    void Store(const PoseKey& key, const std::vector<glm::mat4>& palette)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Entries.count(key))
+            return;
+        // palettes of earlier frames are overwritten in place instead of freed
+        if (m_NumPalettes == static_cast<int>(m_Palettes.size()))
+            m_Palettes.push_back(palette);
+        else
+            m_Palettes[m_NumPalettes] = palette;
+        m_Entries[key] = m_NumPalettes++;
+    }
+
+    /* lookups since BeginFrame */
+    inline int GetNumHits() const { return m_Hits; }
+    inline int GetNumMisses() const { return m_Misses; }
+    inline int GetNumEntries() const { return m_NumPalettes; }
+    float GetHitRate() const
+    {
+        int lookups = m_Hits + m_Misses;
+        return lookups > 0 ? static_cast<float>(m_Hits) / lookups : 0.0f;
+    }
+
+private:
+    float m_TimeStep;
+    std::mutex m_Mutex;
+    std::unordered_map<PoseKey, int, PoseKeyHash> m_Entries;
+    std::vector<std::vector<glm::mat4>> m_Palettes;
+    int m_NumPalettes = 0;
+    std::atomic<int> m_Hits{0};
+    std::atomic<int> m_Misses{0};
+};
+
+#endif /* pose_cache_h */
@@ -0,0 +1,123 @@
+//
+//  skeleton.h
+//  skeletal_animation
+//
+
+#ifndef skeleton_h
+#define skeleton_h
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <glm/glm.hpp>
+#include <assimp/scene.h>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+#include "assimp_glm_helpers.h"
+#include "pose.h"
+
+/* node hierarchy of a scene flattened into arrays in parent-before-child order, so every
+   parent is evaluated before its children by a single forward loop. names are only needed
+   while binding and live in their own array, away from the transforms. */
+class Skeleton
+{
+public:
+    Skeleton() = default;
+
+    explicit Skeleton(const aiNode* root)
+    {
+        // depth first with an explicit stack, a node is appended before any of its children
+        std::vector<std::pair<const aiNode*, int>> pending;
+        pending.push_back(std::make_pair(root, -1));
+        while (!pending.empty())
+        {
+            const aiNode* node = pending.back().first;
+            int parent = pending.back().second;
+            pending.pop_back();
+
+            int index = static_cast<int>(m_Parents.size());
+            m_Parents.push_back(parent);
+            m_BindTransforms.push_back(AssimpGLMHelpers::ConvertMatrixToGLMFormat(node->mTransformation));
+            m_BindPoses.push_back(Decompose(m_BindTransforms.back()));
+            m_Names.push_back(node->mName.data);
+            for (unsigned int i = node->mNumChildren; i > 0; i--)
+                pending.push_back(std::make_pair(node->mChildren[i - 1], index));
+        }
+    }
+
+    /* numNodes nodes in parent-before-child order, e.g. as stored in a cooked asset */
+    Skeleton(int numNodes, const int* parents, const glm::mat4* bindTransforms, const std::vector<std::string>& names)
+        : m_Parents(parents, parents + numNodes), m_BindTransforms(bindTransforms, bindTransforms + numNodes), m_Names(names)
+    {
+        for (int node = 0; node < numNodes; node++)
+            m_BindPoses.push_back(Decompose(m_BindTransforms[node]));
+    }
+
+    inline int GetNumNodes() const { return static_cast<int>(m_Parents.size()); }
+    /* parent of every node, -1 for the root. always smaller than the node's own index */
+    inline const int* GetParents() const { return m_Parents.data(); }
+    /* local transform of every node relative to its parent in the bind pose */
+    inline const glm::mat4* GetBindTransforms() const { return m_BindTransforms.data(); }
+    /* the same bind transforms split into translation, rotation and scale, for blending */
+    inline const BoneTransform* GetBindPoses() const { return m_BindPoses.data(); }
+    inline const std::string& GetName(int node) const { return m_Names[node]; }
+
+    /* linear search, meant for load time */
+    int FindNode(const std::string& name) const
+    {
+        for (int node = 0; node < GetNumNodes(); node++)
+        {
+            if (m_Names[node] == name)
+                return node;
+        }
+        return -1;
+    }
+
+    /* whether other has the same nodes in the same order, so node indices carry over */
+    bool Matches(const Skeleton& other) const
+    {
+        return m_Parents == other.m_Parents && m_Names == other.m_Names;
+    }
+
+    /* model space transform of every node in the bind pose */
+    void ComputeBindPose(std::vector<glm::mat4>& modelTransforms) const
+    {
+        modelTransforms.resize(m_Parents.size());
+        for (int node = 0; node < GetNumNodes(); node++)
+        {
+            int parent = m_Parents[node];
+            modelTransforms[node] = parent < 0 ? m_BindTransforms[node]
+                                               : modelTransforms[parent] * m_BindTransforms[node];
+        }
+    }
+
+private:
+    std::vector<int> m_Parents;
+    std::vector<glm::mat4> m_BindTransforms;
+    std::vector<BoneTransform> m_BindPoses;
+    std::vector<std::string> m_Names;
+
+    /* inverse of BoneTransform::ToMatrix for a transform without shear */
+    static BoneTransform Decompose(const glm::mat4& matrix)
+    {
+        BoneTransform pose;
+        pose.translation = glm::vec3(matrix[3]);
+        glm::mat3 rotation(matrix);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            pose.scale[axis] = glm::length(rotation[axis]);
+            if (pose.scale[axis] > 0.0f)
+                rotation[axis] /= pose.scale[axis];
+        }
+        // a mirrored node keeps a proper rotation and flips one axis of its scale
+        if (glm::determinant(rotation) < 0.0f)
+        {
+            pose.scale.x = -pose.scale.x;
+            rotation[0] = -rotation[0];
+        }
+        pose.rotation = glm::normalize(glm::quat_cast(rotation));
+        return pose;
+    }
+};
+
+#endif /* skeleton_h */
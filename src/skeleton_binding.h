@@ -0,0 +1,108 @@
+//
+//  skeleton_binding.h
+//  skeletal_animation
+//
+
+#ifndef skeleton_binding_h
+#define skeleton_binding_h
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <assimp/scene.h>
+#include "animdata.h"
+#include "skeleton.h"
+
+/* the node hierarchy of a scene bound to the bone palette of its model. it does not depend on
+   any clip, so every clip imported from the scene shares one binding. */
+class SkeletonBinding
+{
+public:
+    /* bind pose lever of a bone, turns key errors into model space distances */
+    struct BindReach {
+        float distance;     // farthest descendant joint (or the bone length for leaves)
+        float parentScale;  // scale of the parent's model space transform
+    };
+
+    /* detail nodes span less than this fraction of the whole skeleton */
+    static constexpr float DetailBoneFraction = 0.1f;
+
+    SkeletonBinding() = default;
+
+    SkeletonBinding(const aiNode* root, const std::map<std::string, BoneInfo>& boneInfoMap)
+        : SkeletonBinding(Skeleton(root), boneInfoMap)
+    {
+    }
+
+    SkeletonBinding(const Skeleton& skeleton, const std::map<std::string, BoneInfo>& boneInfoMap)
+        : m_Skeleton(skeleton), m_BoneInfoMap(boneInfoMap)
+    {
+        int numNodes = m_Skeleton.GetNumNodes();
+        m_NodeSlots.assign(numNodes, -1);
+        m_NodeOffsets.assign(numNodes, glm::mat4(1.0f));
+        for (int node = 0; node < numNodes; node++)
+        {
+            auto boneInfo = m_BoneInfoMap.find(m_Skeleton.GetName(node));
+            if (boneInfo != m_BoneInfoMap.end())
+            {
+                m_NodeSlots[node] = boneInfo->second.id;
+                m_NodeOffsets[node] = boneInfo->second.offset;
+            }
+        }
+
+        std::vector<BindReach> reaches;
+        MeasureBindReach(reaches);
+        m_DetailNodes.assign(numNodes, 0);
+        float extent = numNodes > 0 ? reaches[0].distance : 0.0f;
+        for (int node = 1; node < numNodes; node++)
+            m_DetailNodes[node] = reaches[node].distance < DetailBoneFraction * extent;
+    }
+
+    inline const Skeleton& GetSkeleton() const { return m_Skeleton; }
+    inline const std::map<std::string, BoneInfo>& GetBoneInfoMap() const { return m_BoneInfoMap; }
+    /* slot of the final bone matrices every node writes and the offset matrix that goes with it,
+       -1 marks nodes without a slot */
+    inline const int* GetNodeSlots() const { return m_NodeSlots.data(); }
+    inline const glm::mat4* GetNodeOffsets() const { return m_NodeOffsets.data(); }
+    /* non-zero for detail nodes: small extremities such as fingers or helper bones */
+    inline const unsigned char* GetDetailNodes() const { return m_DetailNodes.data(); }
+
+    void MeasureBindReach(std::vector<BindReach>& reaches) const
+    {
+        std::vector<glm::mat4> bindPose;
+        m_Skeleton.ComputeBindPose(bindPose);
+        const int* parents = m_Skeleton.GetParents();
+        int numNodes = m_Skeleton.GetNumNodes();
+
+        reaches.resize(numNodes);
+        for (int node = 0; node < numNodes; node++)
+        {
+            glm::mat4 parentTransform = parents[node] < 0 ? glm::mat4(1.0f) : bindPose[parents[node]];
+            glm::vec3 origin(bindPose[node][3]);
+            reaches[node].distance = glm::length(origin - glm::vec3(parentTransform[3]));
+            reaches[node].parentScale = std::max(glm::length(glm::vec3(parentTransform[0])),
+                                                 std::max(glm::length(glm::vec3(parentTransform[1])),
+                                                          glm::length(glm::vec3(parentTransform[2]))));
+        }
+
+        // every joint extends the reach of all its ancestors
+        for (int node = 0; node < numNodes; node++)
+        {
+            glm::vec3 origin(bindPose[node][3]);
+            for (int ancestor = parents[node]; ancestor >= 0; ancestor = parents[ancestor])
+                reaches[ancestor].distance = std::max(reaches[ancestor].distance,
+                                                      glm::length(origin - glm::vec3(bindPose[ancestor][3])));
+        }
+    }
+
+private:
+    Skeleton m_Skeleton;
+    std::map<std::string, BoneInfo> m_BoneInfoMap;
+    std::vector<int> m_NodeSlots;
+    std::vector<glm::mat4> m_NodeOffsets;
+    std::vector<unsigned char> m_DetailNodes;
+};
+
+#endif /* skeleton_binding_h */
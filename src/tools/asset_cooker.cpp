@@ -0,0 +1,131 @@
+//
+//  asset_cooker.cpp
+//  skeletal_animation
+//
+#include <asset_cooker.h>
+#include <job_system.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+void printUsage()
+{
+    std::cout << "$./build/bin/asset_cooker [options] [source path]..." << std::endl;
+    std::cout << "e.g. $./bin/asset_cooker -o ../resources/cooked ../resources/*.dae" << std::endl;
+    std::cout << "  -o [directory]      write the cooked files there instead of next to their sources" << std::endl;
+    std::cout << "  -j [threads]        cook this many sources at once (default: every core)" << std::endl;
+    std::cout << "  -f                  cook every source, even when its cooked file is up to date" << std::endl;
+    std::cout << "  -p [profile]        import profile: runtime-minimal (default) or full-quality" << std::endl;
+    std::cout << "  --resample [rate]   resample every clip to rate keys per second" << std::endl;
+    std::cout << "  --reduce [units]    drop keys within this model space error" << std::endl;
+    std::cout << "  --reduce-angle [rad] also cap the rotation error of every bone" << std::endl;
+}
+
+/* source.dae cooks into source.dae.skc, next to the source or in outputDirectory */
+std::string cookedPath(const std::string& sourcePath, const std::string& outputDirectory)
+{
+    std::string fileName = sourcePath.substr(sourcePath.find_last_of('/') + 1) + ".skc";
+    if (outputDirectory.empty())
+        return sourcePath + ".skc";
+    return outputDirectory + "/" + fileName;
+}
+
+int main(int argc, const char * argv[]) {
+    CookSettings settings;
+    std::string outputDirectory;
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    bool force = false;
+    std::vector<std::string> sources;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "-o" && hasValue)
+            outputDirectory = argv[++i];
+        else if (argument == "-j" && hasValue)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "-f")
+            force = true;
+        else if (argument == "-p" && hasValue)
+        {
+            const ImportProfile* profile = ImportProfile::Find(argv[++i]);
+            if (!profile || !AssetCooker::CanCook(*profile))
+            {
+                printUsage();
+                return -1;
+            }
+            settings.profile = *profile;
+        }
+        else if (argument == "--resample" && hasValue)
+            settings.animation.resampleRate = static_cast<float>(std::atof(argv[++i]));
+        else if (argument == "--reduce" && hasValue)
+            settings.animation.reducePositionTolerance = static_cast<float>(std::atof(argv[++i]));
+        else if (argument == "--reduce-angle" && hasValue)
+            settings.animation.reduceAngleTolerance = static_cast<float>(std::atof(argv[++i]));
+        else if (argument[0] == '-')
+        {
+            printUsage();
+            return -1;
+        }
+        else
+            sources.push_back(argument);
+    }
+    if (sources.empty())
+    {
+        printUsage();
+        return -1;
+    }
+
+    // two sources with the same file name would cook into the same output
+    std::map<std::string, std::string> outputs;
+    for (const std::string& source : sources)
+    {
+        std::string output = cookedPath(source, outputDirectory);
+        auto existing = outputs.insert(std::make_pair(output, source));
+        if (!existing.second && existing.first->second != source)
+        {
+            std::cout << source << " and " << existing.first->second << " both cook into " << output << std::endl;
+            return -1;
+        }
+    }
+
+    AssetCooker cooker(settings);
+    std::vector<CookResult> results(sources.size(), CookFailed);
+    // every cook writes its report apart, they are printed in source order once all are done
+    std::vector<std::string> reports(sources.size());
+    auto start = std::chrono::steady_clock::now();
+    {
+        JobSystem jobs(std::min(threads, static_cast<int>(sources.size())));
+        jobs.ParallelFor(static_cast<int>(sources.size()), 1, [&](int begin, int end) {
+            for (int source = begin; source < end; source++)
+            {
+                std::ostringstream report;
+                results[source] = cooker.Cook(sources[source], cookedPath(sources[source], outputDirectory), force, report);
+                reports[source] = report.str();
+            }
+        });
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    int numCooked = 0, numUpToDate = 0, numFailed = 0;
+    for (size_t source = 0; source < sources.size(); source++)
+    {
+        std::cout << reports[source];
+        if (results[source] == CookFailed)
+            std::cout << "failed: " << sources[source] << std::endl;
+        numCooked += results[source] == Cooked;
+        numUpToDate += results[source] == CookUpToDate;
+        numFailed += results[source] == CookFailed;
+    }
+    std::cout << "cooked " << numCooked << ", up to date " << numUpToDate << ", failed " << numFailed << " in "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    return numFailed > 0 ? 1 : 0;
+}